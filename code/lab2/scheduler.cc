@@ -11,8 +11,8 @@
 //	end up calling FindNextToRun(), and that would put us in an
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Threads run by priority, FIFO within a priority; see the run
+//	queue in scheduler.h.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -22,14 +22,94 @@
 #include "scheduler.h"
 #include "system.h"
 
+//----------------------------------------------------------------------
+// FirstSet
+// 	Return the number of the lowest bit set in "bits", which must not
+//	be 0 -- that is, the highest priority with a thread ready.
+//----------------------------------------------------------------------
+
+static int FirstSet(unsigned long long bits)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(bits);
+#else
+    int bit = 0;
+
+    while ((bits & 1) == 0)
+    {
+        bits >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+//----------------------------------------------------------------------
+// RunQueue::RunQueue
+// 	Initialize an empty run queue.
+//----------------------------------------------------------------------
+
+RunQueue::RunQueue()
+{
+    ASSERT(NumPriorities <= (int)(8 * sizeof(nonEmpty)));
+    nonEmpty = 0;
+}
+
+//----------------------------------------------------------------------
+// RunQueue::Append
+// 	Put "thread" at the end of the FIFO for its priority.
+//----------------------------------------------------------------------
+
+void RunQueue::Append(Thread *thread)
+{
+    int p = thread->getPriority();
+
+    ASSERT((p >= 0) && (p < NumPriorities));
+    fifo[p].Append(thread);
+    nonEmpty |= 1ULL << p;
+}
+
+//----------------------------------------------------------------------
+// RunQueue::RemoveFirst
+// 	Take the thread at the front of the highest priority FIFO that
+//	isn't empty, and return it; NULL if the queue is empty.
+//----------------------------------------------------------------------
+
+Thread *
+RunQueue::RemoveFirst()
+{
+    Thread *thread;
+    int p;
+
+    if (nonEmpty == 0)
+        return NULL;
+    p = FirstSet(nonEmpty);
+    thread = fifo[p].Remove();
+    if (fifo[p].IsEmpty())
+        nonEmpty &= ~(1ULL << p);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// RunQueue::Print
+// 	Print the threads in the order they will run.
+//----------------------------------------------------------------------
+
+void RunQueue::Print()
+{
+    for (int p = 0; p < NumPriorities; p++)
+        fifo[p].Mapcar((VoidFunctionPtr)ThreadPrint);
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
-// 	Initialize the list of ready but not running threads to empty.
+// 	Initialize the run queue of ready but not running threads to
+//	empty.
 //----------------------------------------------------------------------
 
 Scheduler::Scheduler()
 {
-    readyList = new List;
+    readyList = new RunQueue;
 }
 
 //----------------------------------------------------------------------
@@ -45,7 +125,8 @@ Scheduler::~Scheduler()
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
-//	Put it on the ready list, for later scheduling onto the CPU.
+//	Put it on the run queue, behind any threads of the same priority,
+//	for later scheduling onto the CPU.
 //
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
@@ -55,8 +136,7 @@ void Scheduler::ReadyToRun(Thread *thread)
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
     thread->setStatus(READY);
-    // readyList->Append((void *)thread);
-    readyList->SortedInsert((void *)thread, thread->getPriority());
+    readyList->Append(thread);
 }
 
 //----------------------------------------------------------------------
@@ -70,7 +150,7 @@ void Scheduler::ReadyToRun(Thread *thread)
 Thread *
 Scheduler::FindNextToRun()
 {
-    return (Thread *)readyList->Remove();
+    return readyList->RemoveFirst();
 }
 
 //----------------------------------------------------------------------
@@ -102,6 +182,11 @@ void Scheduler::Run(Thread *nextThread)
     oldThread->CheckOverflow(); // check if the old thread
                                 // had an undetected stack overflow
 
+    if (nextThread != oldThread)
+    {                            // threads blocked without a stack
+        oldThread->DropStack();  // give up the old one, and get a
+        nextThread->StartOver(); // new one to run on
+    }
     currentThread = nextThread;        // switch to the next thread
     currentThread->setStatus(RUNNING); // nextThread is now running
 
@@ -118,14 +203,11 @@ void Scheduler::Run(Thread *nextThread)
     DEBUG('t', "Now in thread \"%s\"\n", currentThread->getName());
 
     // If the old thread gave up the processor because it was finishing,
-    // we need to delete its carcass.  Note we cannot delete the thread
+    // we need to delete its carcass (or if it blocked without its
+    // stack, free that).  Note we cannot delete the thread
     // before now (for example, in Thread::Finish()), because up to this
     // point, we were still running on the old thread's stack!
-    if (threadToBeDestroyed != NULL)
-    {
-        delete threadToBeDestroyed;
-        threadToBeDestroyed = NULL;
-    }
+    SwitchDone();
 
 #ifdef USER_PROGRAM
     if (currentThread->space != NULL)
@@ -144,5 +226,5 @@ void Scheduler::Run(Thread *nextThread)
 void Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr)ThreadPrint);
+    readyList->Print();
 }
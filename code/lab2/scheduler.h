@@ -0,0 +1,68 @@
+// scheduler.h 
+//	Data structures for the thread dispatcher and scheduler.
+//	Primarily, the run queue of threads that are ready to run.
+//
+//	Threads run in priority order, 0 first, and in FIFO order within
+//	a priority.  The run queue keeps a FIFO of threads per priority,
+//	linked through the threads themselves, and a bitmap of which
+//	priorities have a thread ready; so putting a thread on the queue,
+//	and finding the highest priority one, take constant time, and
+//	don't allocate anything.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "copyright.h"
+#include "list.h"
+#include "thread.h"
+
+#define NumPriorities	10	// priorities 0 (highest) to 9; the bitmap
+				// has room for up to 64
+
+// The following class defines the run queue: the threads that are
+// ready to run, by priority.
+
+class RunQueue {
+  public:
+    RunQueue();				// Initialize an empty run queue
+
+    void Append(Thread* thread);	// Put a thread at the end of
+					// its priority's FIFO
+    Thread* RemoveFirst();		// Take the first thread of the
+					// highest priority, or NULL
+    bool IsEmpty() { return nonEmpty == 0; }
+    void Print();			// Print the threads, in order
+
+  private:
+    ThreadList fifo[NumPriorities];	// each priority's FIFO
+    unsigned long long nonEmpty;	// bit p set if priority p has a
+					// thread
+};
+
+// The following class defines the scheduler/dispatcher abstraction -- 
+// the data structures and operations needed to keep track of which 
+// thread is running, and which threads are ready but not running.
+
+class Scheduler {
+  public:
+    Scheduler();			// Initialize list of ready threads 
+    ~Scheduler();			// De-allocate ready list
+
+    void ReadyToRun(Thread* thread);	// Thread can be dispatched.
+    Thread* FindNextToRun();		// Dequeue first thread on the ready 
+					// list, if any, and return thread.
+    void Run(Thread* nextThread);	// Cause nextThread to start running
+    void Print();			// Print contents of ready list
+    bool HasReadyThreads() { return !readyList->IsEmpty(); }
+					// Is any thread waiting to run?
+    
+  private:
+    RunQueue *readyList;  	// threads that are ready to run,
+				// but not running
+};
+
+#endif // SCHEDULER_H
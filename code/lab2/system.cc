@@ -153,7 +153,9 @@ Initialize(int argc, char **argv)
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
     
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg);	// this must come first
+    machine = new Machine(debugUserProg, InterpretMode, DefaultPhysPages,
+			  DefaultTLBSize, 0, LRUReplace,
+			  FALSE);		// this must come first
 #endif
 
 #ifdef FILESYS
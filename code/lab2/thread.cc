@@ -39,6 +39,7 @@ Thread::Thread(char *threadName)
     stack = NULL;
     status = JUST_CREATED;
     priority = 9; // 设置默认优先级为9
+    continuation = NULL;
 #ifdef USER_PROGRAM
     space = NULL;
 #endif
@@ -51,6 +52,7 @@ Thread::Thread(char *threadName, int p)
     stack = NULL;
     status = JUST_CREATED;
     priority = p;
+    continuation = NULL;
 #ifdef USER_PROGRAM
     space = NULL;
 #endif
@@ -99,7 +101,7 @@ Thread::~Thread()
 
 void Thread::Fork(VoidFunctionPtr func, _int arg)
 {
-#ifdef HOST_ALPHA
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
     DEBUG('t', "Forking thread \"%s\" with func = 0x%lx, arg = %ld\n",
           name, (long)func, arg);
 #else
@@ -115,6 +117,26 @@ void Thread::Fork(VoidFunctionPtr func, _int arg)
     (void)interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Thread::ForkContinuation
+// 	Like Fork, but the thread is only given a stack when it is first
+//	dispatched, so that a great many threads can be forked, and wait
+//	to run, cheaply.
+//
+//	"func" is the procedure to run concurrently.
+//	"arg" is a single argument to be passed to the procedure.
+//----------------------------------------------------------------------
+
+void Thread::ForkContinuation(VoidFunctionPtr func, _int arg)
+{
+    continuation = func;
+    continuationArg = arg;
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    scheduler->ReadyToRun(this);
+    (void)interrupt->SetLevel(oldLevel);
+}
+
 //----------------------------------------------------------------------
 // Thread::CheckOverflow
 // 	Check a thread's stack to see if it has overrun the space
@@ -239,16 +261,119 @@ void Thread::Sleep()
     scheduler->Run(nextThread); // returns when we've been signalled
 }
 
+// Where Block saves the state of the stack it abandons, when it starts
+// a thread over without switching to another thread; never resumed.
+static Thread leftBehind("left behind");
+
+//----------------------------------------------------------------------
+// Thread::Block
+// 	Like Sleep, but the thread gives up its stack while it waits, so
+//	that all it takes up is its Thread object.  When it is woken, it
+//	starts over in (*func)(arg), on a new stack, with interrupts
+//	enabled; when that returns, the thread finishes.  So Block never
+//	returns.
+//
+//	Scheduler::Run frees the stack once it has switched off it.  If
+//	the thread is woken before any other thread runs (the CPU was
+//	idle), Sleep returns here instead; we still start over on a new
+//	stack, rather than call (*func)(arg) on top of Block and Sleep,
+//	or a thread that blocks again each time it is woken would pile
+//	up another set of their frames per wakeup.
+//
+//	NOTE: as with Sleep, interrupts must already be disabled.
+//
+//	"func" is the procedure to start over in.
+//	"arg" is a single argument to be passed to the procedure.
+//----------------------------------------------------------------------
+
+void Thread::Block(VoidFunctionPtr func, _int arg)
+{
+    ASSERT(stack != NULL); // not the main thread
+    CheckOverflow();
+    continuation = func;
+    continuationArg = arg;
+    Sleep(); // returns only if no one else ran
+
+    DropStack();                // so start over as if they had:
+    StartOver();                // SwitchDone, in ThreadBegin, frees
+    SWITCH(&leftBehind, this);  // the stack we leave
+    ASSERT(FALSE);              // not reached
+}
+
+//----------------------------------------------------------------------
+// Thread::DropStack
+// 	If the thread has blocked without its stack, let it go: it is
+//	freed by SwitchDone, once we have switched to another thread.
+//----------------------------------------------------------------------
+
+static int *stackToBeFreed = NULL; // the stack DropStack let go of
+
+void Thread::DropStack()
+{
+    if ((continuation != NULL) && (stack != NULL))
+    {
+        ASSERT(stackToBeFreed == NULL);
+        stackToBeFreed = stack;
+        stack = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// Thread::StartOver
+// 	If the thread has no stack because it blocked without one (or
+//	because it was forked with ForkContinuation), give it a new one,
+//	so that switching to it runs its continuation.  Stacks are
+//	recycled (see AllocBoundedArray), so this is cheap.
+//----------------------------------------------------------------------
+
+void Thread::StartOver()
+{
+    if ((continuation != NULL) && (stack == NULL))
+    {
+        StackAllocate(continuation, continuationArg);
+        continuation = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// SwitchDone
+// 	Called on the new thread's stack, once SWITCH has switched to it
+//	(from Scheduler::Run, or, for a thread that is just starting, from
+//	ThreadRoot): delete the thread that finished, and free the stack
+//	of the one that blocked without it, if we switched from either.
+//	Neither could be done before, because we were still running on
+//	the old thread's stack!
 //----------------------------------------------------------------------
-// ThreadFinish, InterruptEnable, ThreadPrint
+
+void SwitchDone()
+{
+    if (threadToBeDestroyed != NULL)
+    {
+        delete threadToBeDestroyed;
+        threadToBeDestroyed = NULL;
+    }
+    if (stackToBeFreed != NULL)
+    {
+        DeallocBoundedArray((char *)stackToBeFreed, StackSize * sizeof(_int));
+        stackToBeFreed = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// ThreadFinish, ThreadBegin, ThreadPrint
 //	Dummy functions because C++ does not allow a pointer to a member
 //	function.  So in order to do this, we create a dummy C function
 //	(which we can pass a pointer to), that then simply calls the
-//	member function.
+//	member function.  ThreadBegin is the first thing a new thread
+//	does: clean up after the old one, and enable interrupts.
 //----------------------------------------------------------------------
 
 static void ThreadFinish() { currentThread->Finish(); }
-static void InterruptEnable() { interrupt->Enable(); }
+static void ThreadBegin()
+{
+    SwitchDone();
+    interrupt->Enable();
+}
 void ThreadPrint(_int arg)
 {
     Thread *t = (Thread *)arg;
@@ -269,7 +394,12 @@ void ThreadPrint(_int arg)
 
 void Thread::StackAllocate(VoidFunctionPtr func, _int arg)
 {
-    stack = (int *)AllocBoundedArray(StackSize * sizeof(_int));
+    bool pooled;
+
+    stack = (int *)AllocBoundedArray(StackSize * sizeof(_int), &pooled);
+    stats->numStacksAllocated++;
+    if (pooled)
+        stats->numStacksPooled++; // 栈是从池中重用的
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
@@ -359,12 +489,18 @@ void Thread::StackAllocate(VoidFunctionPtr func, _int arg)
     // Sep 1, 2003
 
 #endif
+#ifdef HOST_x86_64
+    // x86-64 的 SWITCH 不保存 PC：新线程通过栈上的返回地址进入
+    // ThreadRoot，且该位置按 16 字节对齐，满足 ABI 的要求
+    stackTop = (int *)((char *)stackTop - 16);
+    *(_int *)stackTop = (_int)ThreadRoot;
+#endif
 #endif // HOST_SPARC
     *stack = STACK_FENCEPOST;
 #endif // HOST_SNAKE
 
     machineState[PCState] = (_int)ThreadRoot;
-    machineState[StartupPCState] = (_int)InterruptEnable;
+    machineState[StartupPCState] = (_int)ThreadBegin;
     machineState[InitialPCState] = (_int)func;
     machineState[InitialArgState] = arg;
     machineState[WhenDonePCState] = (_int)ThreadFinish;
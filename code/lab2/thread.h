@@ -39,6 +39,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "list.h"
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -66,6 +67,9 @@ enum ThreadStatus
 // external function, dummy routine whose sole job is to call Thread::Print
 extern void ThreadPrint(_int arg);
 
+// external function, to clean up after the thread we just switched from
+extern void SwitchDone();
+
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
 //
@@ -76,6 +80,12 @@ extern void ThreadPrint(_int arg);
 //
 //  Some threads also belong to a user address space; threads
 //  that only run in the kernel have a NULL address space.
+//
+//  A thread can also block without its stack, giving a "continuation"
+//  -- a procedure and its argument -- to start over in once it is
+//  woken, on a new stack; it then costs only its Thread object while
+//  it waits.  Semaphore, Lock and Condition have versions of P, Acquire
+//  and Wait that do this.
 
 class Thread
 {
@@ -104,6 +114,19 @@ public:
                                              // relinquish the processor
   void Finish();                             // The thread is done executing
 
+  void ForkContinuation(VoidFunctionPtr func, _int arg); // Make thread run
+                                                         // (*func)(arg), but only
+                                                         // give it a stack once
+                                                         // it is dispatched
+  void Block(VoidFunctionPtr func, _int arg); // Sleep without a stack, and
+                                              // start over in (*func)(arg)
+                                              // when woken; doesn't return
+  bool HasContinuation() { return (continuation != NULL); }
+  void DropStack();  // Give up the stack, if blocked without one
+                     // (called by Scheduler::Run)
+  void StartOver();  // Give a thread blocked without a stack a new one,
+                     // to run its continuation on (called by Scheduler::Run)
+
   void CheckOverflow(); // Check if thread has
                         // overflowed its stack
   void setStatus(ThreadStatus st) { status = st; }
@@ -121,6 +144,9 @@ public:
   }
   void Print() { printf("%s, ", name); }
 
+  ListLink<Thread> queueLink; // 线程所在的唯一队列的链接：运行队列中同一优先级
+                              // 的队列，或者它所等待对象的队列（见 list.h）
+
 private:
   // some of the private data for this class is listed above
 
@@ -130,6 +156,9 @@ private:
   ThreadStatus status; // ready, running or blocked
   char *name;
   int priority; // 优先级属性，可以设定一个范围0~9
+  VoidFunctionPtr continuation; // where the thread starts over, if it
+                                // blocked without a stack; or NULL
+  _int continuationArg;         // and the argument to pass it
 
   void StackAllocate(VoidFunctionPtr func, _int arg);
   // Allocate a stack for thread.
@@ -150,6 +179,9 @@ public:
 #endif
 };
 
+// A queue of threads, linked through their queueLink (see list.h).
+typedef IntrusiveList<Thread, &Thread::queueLink> ThreadList;
+
 // Magical machine-dependent routines, defined in switch.s
 
 extern "C"
@@ -20,7 +20,7 @@
 #include "addrspace.h"
 #include "noff.h"
 
-BitMap *AddrSpace::bitmap = new BitMap(NumPhysPages);
+BitMap *AddrSpace::bitmap = NULL; // 物理页分配图，在第一次创建地址空间时按内存大小建立
 
 //-----------------------------------------------------------------------
 // SwapHeader
@@ -87,7 +87,9 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
-    ASSERT(numPages <= NumPhysPages);
+    ASSERT(numPages <= (unsigned int) machine->numPhysPages);
+    if (bitmap == NULL)
+        bitmap = new BitMap(machine->numPhysPages);
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", numPages, size);
 
     // first, set up the translation
@@ -112,6 +114,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
         int code_phy_addr = pageTable[code_page].physicalPage * PageSize;
         //read memory
         executable->ReadAt(&(machine->mainMemory[code_phy_addr]), noffH.code.size, noffH.code.inFileAddr);
+        machine->InvalidateDecoded(code_phy_addr, noffH.code.size);
     }
 
     if (noffH.initData.size > 0)
@@ -126,11 +129,50 @@ AddrSpace::AddrSpace(OpenFile *executable)
         int data_phy_addr = pageTable[data_page].physicalPage * PageSize + data_offset;
         //read memory
         executable->ReadAt(&(machine->mainMemory[data_phy_addr]), noffH.initData.size, noffH.initData.inFileAddr);
+        machine->InvalidateDecoded(data_phy_addr, noffH.initData.size);
     }
 
     Print();
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Re-create an address space from a checkpoint: read back the page
+//	table written by AddrSpace::Checkpoint, and mark its frames in use.
+//	The pages themselves were restored along with the rest of physical
+//	memory, by Machine::Restore.
+//
+//	"checkpoint" is the open host file holding the checkpoint
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(int checkpoint)
+{
+    bool flag = false;
+    for (int i = 0; i < 128; i++)
+    {
+        if (!ThreadMap[i])
+        {
+            ThreadMap[i] = 1;
+            flag = true;
+            spaceID = i;
+            break;
+        }
+    }
+    ASSERT(flag);
+
+    Read(checkpoint, (char *)&numPages, sizeof(numPages));
+    ASSERT(numPages <= (unsigned int) machine->numPhysPages);
+    if (bitmap == NULL)
+        bitmap = new BitMap(machine->numPhysPages);
+    pageTable = new TranslationEntry[numPages];
+    Read(checkpoint, (char *)pageTable, numPages * sizeof(TranslationEntry));
+    for (unsigned int i = 0; i < numPages; i++)
+    {
+        ASSERT(!bitmap->Test(pageTable[i].physicalPage));
+        bitmap->Mark(pageTable[i].physicalPage);
+    }
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
 // 	Dealloate an address space.  Nothing for now!
@@ -139,6 +181,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
 AddrSpace::~AddrSpace()
 {
     ThreadMap[spaceID] = 0;
+    machine->FlushTLB(spaceID); // 地址空间 ID 将被重用，清除其 TLB 表项
 
     // Clear pageTable
     for (int i = 0; i < numPages; i++)
@@ -187,6 +230,19 @@ void AddrSpace::SaveState()
 {
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::Checkpoint
+// 	Save the address space to the open host file "fd", as part of a
+//	checkpoint: just the size and the page table, since the contents
+//	are in physical memory, which the machine saves.
+//----------------------------------------------------------------------
+
+void AddrSpace::Checkpoint(int fd)
+{
+    WriteFile(fd, (char *)&numPages, sizeof(numPages));
+    WriteFile(fd, (char *)pageTable, numPages * sizeof(TranslationEntry));
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::RestoreState
 // 	On a context switch, restore the machine state so that
@@ -199,6 +255,8 @@ void AddrSpace::RestoreState()
 {
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->asid = spaceID;
+    machine->FlushSoftTLB();
 }
 
 //----------------------------------------------------------------------
@@ -25,6 +25,9 @@ public:
   AddrSpace(OpenFile *executable); // Create an address space,
                                    // initializing it with the program
                                    // stored in the file "executable"
+  AddrSpace(int checkpoint);       // Re-create an address space saved
+                                   // by Checkpoint, from the open host
+                                   // file "checkpoint"
   ~AddrSpace();                    // De-allocate an address space
 
   void InitRegisters(); // Initialize user-level CPU registers,
@@ -35,6 +38,8 @@ public:
 
   void Print();
 
+  void Checkpoint(int fd); // Save the page table to open host file "fd"
+
   int getSpaceID() { return spaceID; }
 
 private:
@@ -33,7 +33,7 @@ AddrSpace *space;
 // StartProcess
 //----------------------------------------------------------------------
 
-void StartProcess(int n)
+void StartProcess(_int n)
 {
     currentThread->space = space;
     currentThread->space->InitRegisters();
@@ -97,11 +97,13 @@ void ExceptionHandler(ExceptionType which)
             //read argument
             char filename[50];
             int addr = machine->ReadRegister(4);
-            int i = 0;
-            do
+            if (!machine->CopyStringFromUser(addr, filename, sizeof(filename)))
             {
-                machine->ReadMem(addr + i, 1, (int *)&filename[i]);
-            } while (filename[i++] != '\0');
+                printf("Exec: bad file name at 0x%x\n", addr);
+                machine->WriteRegister(2, -1);
+                AdvancePC();
+                break;
+            }
 
             printf("Exec(%s):\n", filename);
 
@@ -2,7 +2,8 @@
 //	Test routines for demonstrating that Nachos can load
 //	a user program and execute it.
 //
-//	Also, routines for testing the Console hardware device.
+//	Also, routines for testing the Console hardware device, and
+//	for checkpointing a running user program and restoring it.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -44,6 +45,94 @@ void StartProcess(char *filename)
                     // by doing the syscall "exit"
 }
 
+// A checkpoint is taken by the simulator at an instruction boundary,
+// so it is scheduled as an interrupt; if it falls due at a bad moment
+// it is tried again this many ticks later.
+#define CheckpointRetry 100
+
+static char *checkpointFile; // where to write the checkpoint
+
+//----------------------------------------------------------------------
+// CheckpointHandler
+// 	Write the checkpoint requested by ScheduleCheckpoint: the machine
+//	state, then the address space of the running user program.  The
+//	program carries on running afterwards.
+//
+//	Only a single user program, interrupted in the middle of user
+//	code, can be saved: there must be no other thread ready to run,
+//	and no disk, console or network operation in progress, since
+//	their state lives in host memory.  Until then, keep waiting.
+//----------------------------------------------------------------------
+
+static void CheckpointHandler(_int dummy)
+{
+    int fd;
+
+    if ((interrupt->InterruptedStatus() != UserMode) || (currentThread->space == NULL) ||
+        scheduler->HasReadyThreads() || interrupt->IOPending())
+    {
+        DEBUG('a', "Checkpoint postponed at time %lld\n", stats->totalTicks);
+        interrupt->Schedule(CheckpointHandler, 0, CheckpointRetry, TimerInt);
+        return;
+    }
+    fd = OpenForWrite(checkpointFile);
+    machine->Checkpoint(fd);
+    currentThread->space->Checkpoint(fd);
+    Close(fd);
+    printf("Checkpoint written to %s at time %lld\n", checkpointFile, stats->totalTicks);
+}
+
+//----------------------------------------------------------------------
+// ScheduleCheckpoint
+// 	Arrange for the running user program to be saved to the host file
+//	"filename" once "ticks" more ticks have gone by.  A later run can
+//	then pick up from that point with RestoreProcess.
+//
+//	The Nachos disk (-f, DISK) is a separate host file; copy it along
+//	with the checkpoint if the program uses the file system.
+//----------------------------------------------------------------------
+
+void ScheduleCheckpoint(char *filename, int ticks)
+{
+    checkpointFile = filename;
+    interrupt->Schedule(CheckpointHandler, 0, ticks, TimerInt);
+}
+
+//----------------------------------------------------------------------
+// RestoreProcess
+// 	Run a user program from a checkpoint written by CheckpointHandler,
+//	instead of loading it from its executable.  Simulated time and the
+//	statistics carry on from where the checkpoint was taken.
+//----------------------------------------------------------------------
+
+void RestoreProcess(char *filename)
+{
+    int fd = OpenForReadWrite(filename, FALSE);
+    long long now = stats->totalTicks;
+    AddrSpace *space;
+
+    if (fd < 0)
+    {
+        printf("Unable to open checkpoint %s\n", filename);
+        return;
+    }
+    if (!machine->Restore(fd))
+    {
+        printf("%s is not a checkpoint of this machine (check -mem)\n", filename);
+        Close(fd);
+        return;
+    }
+    interrupt->ShiftPending(stats->totalTicks - now);
+    space = new AddrSpace(fd);
+    currentThread->space = space;
+    Close(fd);
+
+    space->RestoreState(); // load page table register
+
+    machine->Run(); // resume the user program
+    ASSERT(FALSE);  // machine->Run never returns
+}
+
 // Data structures needed for the console test.  Threads making
 // I/O requests wait on a Semaphore to delay until the I/O completes.
 
@@ -179,6 +179,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
             int code_phy_addr = pageTable[i].physicalPage * PageSize;
             // 读内存
             executable->ReadAt(&(machine->mainMemory[code_phy_addr]), PageSize, noffH.code.inFileAddr + i * PageSize);
+            machine->InvalidateDecoded(code_phy_addr, PageSize);
             pageTable[i].valid = TRUE;
             for (int vpc = 0; vpc < MaxPages; vpc++)
                 if (vpTable[vpc] == -1)
@@ -232,6 +233,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
             int data_phy_addr = pageTable[i].physicalPage * PageSize;
             // 读内存
             executable->ReadAt(&(machine->mainMemory[data_phy_addr]), PageSize, noffH.initData.inFileAddr + i * PageSize);
+            machine->InvalidateDecoded(data_phy_addr, PageSize);
             pageTable[i].valid = TRUE;
             for (int vpc = 0; vpc < MaxPages; vpc++)
                 if (vpTable[vpc] == -1)
@@ -270,6 +272,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
 AddrSpace::~AddrSpace()
 {
     ThreadMap[spaceID] = 0;
+    machine->FlushTLB(spaceID); // 地址空间 ID 将被重用，清除其 TLB 表项
 
     // Clear pageTable
     for (int i = 0; i < numPages; i++)
@@ -326,6 +329,8 @@ void AddrSpace::RestoreState()
 {
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->asid = spaceID;
+    machine->FlushSoftTLB();
 }
 
 //----------------------------------------------------------------------
@@ -36,7 +36,7 @@ AddrSpace *space;
 // StartProcess
 //----------------------------------------------------------------------
 
-void StartProcess(int n)
+void StartProcess(_int n)
 {
     currentThread->space = space;
     currentThread->space->InitRegisters();
@@ -197,11 +197,13 @@ void ExceptionHandler(ExceptionType which)
             //read argument
             char filename[50];
             int addr = machine->ReadRegister(4);
-            int i = 0;
-            do
+            if (!machine->CopyStringFromUser(addr, filename, sizeof(filename)))
             {
-                machine->ReadMem(addr + i, 1, (int *)&filename[i]);
-            } while (filename[i++] != '\0');
+                printf("Exec: bad file name at 0x%x\n", addr);
+                machine->WriteRegister(2, -1);
+                AdvancePC();
+                break;
+            }
 
             printf("Exec(%s):\n", filename);
 
@@ -302,6 +304,10 @@ void ExceptionHandler(ExceptionType which)
             swapFile->ReadAt(&(machine->mainMemory[pageSpace->pageTable[page].physicalPage * PageSize]),
                              PageSize, pageSpace->pageTable[page].virtualPage * PageSize);
         }
+        // 换入的物理页内容已改变，丢弃其中预译码的指令
+        machine->InvalidateDecoded(pageSpace->pageTable[page].physicalPage * PageSize, PageSize);
+        // 页表已修改（可能换出了其他页），清除该地址空间的 TLB 表项
+        machine->FlushTLB(pageSpace->getSpaceID());
         pageSpace->pageTable[page].valid = TRUE;
         unsigned int vpn = pageSpace->pageTable[page].virtualPage;
 
@@ -44,6 +44,23 @@ void StartProcess(char *filename)
                     // by doing the syscall "exit"
 }
 
+//----------------------------------------------------------------------
+// ScheduleCheckpoint, RestoreProcess
+// 	Checkpoints (see userprog/progtest.cc) are not supported here: with
+//	demand paging, part of each address space lives in the swap file
+//	rather than in physical memory, and that isn't saved.
+//----------------------------------------------------------------------
+
+void ScheduleCheckpoint(char *filename, int ticks)
+{
+    printf("Checkpoints are not supported with demand paging\n");
+}
+
+void RestoreProcess(char *filename)
+{
+    printf("Checkpoints are not supported with demand paging\n");
+}
+
 // Data structures needed for the console test.  Threads making
 // I/O requests wait on a Semaphore to delay until the I/O completes.
 
@@ -74,42 +74,60 @@ unsigned short ShortToMachine(unsigned short shortword) { return ShortToHost(sho
 //      Read "size" (1, 2, or 4) bytes of virtual memory at "addr" into
 //	the location pointed to by "value".
 //
+//	If the page was translated recently, its frame is found in the
+//	soft TLB and Translate is skipped (the use bit was set when the
+//	translation was cached).
+//
 //   	Returns FALSE if the translation step from virtual to physical memory
 //   	failed.
 //
 //	"addr" -- the virtual address to read from
 //	"size" -- the number of bytes to read (1, 2, or 4)
 //	"value" -- the place to write the result
+//	"tracing" -- if FALSE, 'a' tracing is compiled out
 //----------------------------------------------------------------------
 
+template <bool tracing>
 bool Machine::ReadMem(int addr, int size, int *value)
 {
 	int data;
 	ExceptionType exception;
 	int physicalAddress;
+	SoftTLBEntry *cached = &softTLB[((unsigned)addr / PageSize) % SoftTLBSize];
+	char *hostAddr;
 
-	DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
-
-	exception = Translate(addr, &physicalAddress, size, FALSE);
-	if (exception != NoException)
+	if (!tracing && (cached->virtualPage == (int)((unsigned)addr / PageSize)) && !(addr & (size - 1)))
+		hostAddr = cached->page + (unsigned)addr % PageSize;
+	else
 	{
-		machine->RaiseException(exception, addr);
-		return FALSE;
+		TRACE('a', "Reading VA 0x%x, size %d\n", addr, size);
+
+		exception = Translate<tracing>(addr, &physicalAddress, size, FALSE);
+		if (exception != NoException)
+		{
+			machine->RaiseException(exception, addr);
+			return FALSE;
+		}
+		if (!tracing)
+			FillSoftTLB(addr, physicalAddress, FALSE);
+		hostAddr = &machine->mainMemory[physicalAddress];
 	}
+	if (cache[L1DCache] != NULL)
+		CacheAccess(L1DCache, hostAddr - mainMemory, FALSE);
 	switch (size)
 	{
 	case 1:
-		data = machine->mainMemory[physicalAddress];
+		data = *hostAddr;
 		*value = data;
 		break;
 
 	case 2:
-		data = *(unsigned short *)&machine->mainMemory[physicalAddress];
+		data = *(unsigned short *)hostAddr;
 		*value = ShortToHost(data);
 		break;
 
 	case 4:
-		data = *(unsigned int *)&machine->mainMemory[physicalAddress];
+		data = *(unsigned int *)hostAddr;
 		*value = WordToHost(data);
 		break;
 
@@ -117,7 +135,7 @@ bool Machine::ReadMem(int addr, int size, int *value)
 		ASSERT(FALSE);
 	}
 
-	DEBUG('a', "\tvalue read = %8.8x\n", *value);
+	TRACE('a', "\tvalue read = %8.8x\n", *value);
 	return (TRUE);
 }
 
@@ -126,39 +144,65 @@ bool Machine::ReadMem(int addr, int size, int *value)
 //      Write "size" (1, 2, or 4) bytes of the contents of "value" into
 //	virtual memory at location "addr".
 //
+//	As in ReadMem, Translate is skipped if the page is in the soft
+//	TLB, but only if a write to it has already been translated (so
+//	the dirty bit is set, and the page is known not to be read-only).
+//
 //   	Returns FALSE if the translation step from virtual to physical memory
 //   	failed.
 //
 //	"addr" -- the virtual address to write to
 //	"size" -- the number of bytes to be written (1, 2, or 4)
 //	"value" -- the data to be written
+//	"tracing" -- if FALSE, 'a' tracing is compiled out
 //----------------------------------------------------------------------
 
+template <bool tracing>
 bool Machine::WriteMem(int addr, int size, int value)
 {
 	ExceptionType exception;
 	int physicalAddress;
+	SoftTLBEntry *cached = &softTLB[((unsigned)addr / PageSize) % SoftTLBSize];
+	char *hostAddr;
 
-	DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
-
-	exception = Translate(addr, &physicalAddress, size, TRUE);
-	if (exception != NoException)
+	if (!tracing && (cached->virtualPage == (int)((unsigned)addr / PageSize)) && cached->writable && !(addr & (size - 1)))
 	{
-		machine->RaiseException(exception, addr);
-		return FALSE;
+		hostAddr = cached->page + (unsigned)addr % PageSize;
+		physicalAddress = hostAddr - machine->mainMemory;
+	}
+	else
+	{
+		TRACE('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
+
+		exception = Translate<tracing>(addr, &physicalAddress, size, TRUE);
+		if (exception != NoException)
+		{
+			machine->RaiseException(exception, addr);
+			return FALSE;
+		}
+		if (!tracing)
+			FillSoftTLB(addr, physicalAddress, TRUE);
+		hostAddr = &machine->mainMemory[physicalAddress];
+	}
+	if (cache[L1DCache] != NULL)
+		CacheAccess(L1DCache, physicalAddress, TRUE);
+	if (decodeValid[physicalAddress / 4])
+	{ // overwriting an instruction; accesses never span words
+		decodeValid[physicalAddress / 4] = FALSE;
+		pageVersion[physicalAddress / PageSize]++;
 	}
 	switch (size)
 	{
 	case 1:
-		machine->mainMemory[physicalAddress] = (unsigned char)(value & 0xff);
+		*hostAddr = (unsigned char)(value & 0xff);
 		break;
 
 	case 2:
-		*(unsigned short *)&machine->mainMemory[physicalAddress] = ShortToMachine((unsigned short)(value & 0xffff));
+		*(unsigned short *)hostAddr = ShortToMachine((unsigned short)(value & 0xffff));
 		break;
 
 	case 4:
-		*(unsigned int *)&machine->mainMemory[physicalAddress] = WordToMachine((unsigned int)value);
+		*(unsigned int *)hostAddr = WordToMachine((unsigned int)value);
 		break;
 
 	default:
@@ -181,29 +225,32 @@ bool Machine::WriteMem(int addr, int size, int value)
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
 // 	"writing" -- if TRUE, check the "read-only" bit in the TLB
+//	"tracing" -- if FALSE, 'a' tracing is compiled out
 //----------------------------------------------------------------------
 
+template <bool tracing>
 ExceptionType Machine::Translate(int virtAddr, int *physAddr, int size, bool writing)
 {
-	int i;
 	unsigned int vpn, offset;
 	TranslationEntry *entry;
 	unsigned int pageFrame;
 
-	// 设置页表
+	// 设置页表及其地址空间 ID
 	pageTable = currentThread->space->pageTable;
+	asid = currentThread->space->getSpaceID();
 
-	DEBUG('a', "\tTranslate 0x%x, %s: ", virtAddr, writing ? "write" : "read");
+	TRACE('a', "\tTranslate 0x%x, %s: ", virtAddr, writing ? "write" : "read");
 
 	// check for alignment errors
 	if (((size == 4) && (virtAddr & 0x3)) || ((size == 2) && (virtAddr & 0x1)))
 	{
-		DEBUG('a', "alignment problem at %d, size %d!\n", virtAddr, size);
+		TRACE('a', "alignment problem at %d, size %d!\n", virtAddr, size);
 		return AddressErrorException;
 	}
 
-	// we must have either a TLB or a page table, but not both!
-	ASSERT(tlb == NULL || pageTable == NULL);
+	// we must have either a TLB or a page table, but not both, unless
+	// the TLB is refilled from the page table by the hardware
+	ASSERT(tlb == NULL || pageTable == NULL || tlbWalk);
 	ASSERT(tlb != NULL || pageTable != NULL);
 
 	// calculate the virtual page number, and offset within the page,
@@ -221,57 +268,102 @@ ExceptionType Machine::Translate(int virtAddr, int *physAddr, int size, bool wri
 			break;
 		}
 
-	if (tlb == NULL)
+	entry = NULL;
+	if (tlb != NULL)
+	{
+		entry = tlbModel->Lookup(vpn, asid);
+		if (entry != NULL)
+			stats->numTLBHits++;
+		else
+		{ // not found
+			stats->numTLBMisses++;
+			if (!tlbWalk || (pageTable == NULL))
+			{
+				TRACE('a', "*** no valid TLB entry found for this virtual page!\n");
+				return PageFaultException; // really, this is a TLB fault,
+										   // the page may be in memory,
+										   // but not in the TLB
+			}
+		}
+	}
+	if (entry == NULL)
 	{ // => page table => vpn is index into table
 		if (vpn >= pageTableSize)
 		{
-			DEBUG('a', "virtual page # %d too large for page table size %d!\n", virtAddr, pageTableSize);
+			TRACE('a', "virtual page # %d too large for page table size %d!\n", virtAddr, pageTableSize);
 			return AddressErrorException;
 		}
 		else if (!pageTable[vpn].valid)
 		{
-			DEBUG('a', "virtual page # %d too large for page table size %d!\n", virtAddr, pageTableSize);
+			TRACE('a', "virtual page # %d too large for page table size %d!\n", virtAddr, pageTableSize);
 			printf("Page Fault Exception: Need Page # %d!\n", vpn);
 			return PageFaultException;
 		}
 		entry = &pageTable[vpn];
-	}
-	else
-	{
-		for (entry = NULL, i = 0; i < TLBSize; i++)
-			if (tlb[i].valid && ((unsigned int)tlb[i].virtualPage == vpn))
-			{
-				entry = &tlb[i]; // FOUND!
-				break;
-			}
-		if (entry == NULL)
-		{ // not found
-			DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
-			return PageFaultException; // really, this is a TLB fault,
-									   // the page may be in memory,
-									   // but not in the TLB
+		if (tlb != NULL)
+		{ // hardware refill
+			TRACE('a', "TLB refill, ");
+			entry = RefillTLB(entry);
 		}
 	}
 
 	if (entry->readOnly && writing)
 	{ // trying to write to a read-only page
-		DEBUG('a', "%d mapped read-only at %d in TLB!\n", virtAddr, i);
+		TRACE('a', "%d mapped read-only!\n", virtAddr);
 		return ReadOnlyException;
 	}
 	pageFrame = entry->physicalPage;
 
 	// if the pageFrame is too big, there is something really wrong!
 	// An invalid translation was loaded into the page table or TLB.
-	if (pageFrame >= NumPhysPages)
+	if (pageFrame >= (unsigned int) numPhysPages)
 	{
-		DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
+		TRACE('a', "*** frame %d > %d!\n", pageFrame, numPhysPages);
 		return BusErrorException;
 	}
 	entry->use = TRUE; // set the use, dirty bits
 	if (writing)
 		entry->dirty = TRUE;
+	if (tlbWalk && (pageTable != NULL) && (vpn < pageTableSize))
+	{ // and in the page table, where the kernel looks for them
+		pageTable[vpn].use = TRUE;
+		if (writing)
+			pageTable[vpn].dirty = TRUE;
+	}
 	*physAddr = pageFrame * PageSize + offset;
-	ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
-	DEBUG('a', "phys addr = 0x%x\n", *physAddr);
+	ASSERT((*physAddr >= 0) && ((*physAddr + size) <= memorySize));
+	TRACE('a', "phys addr = 0x%x\n", *physAddr);
 	return NoException;
 }
+
+// Kernel code is not performance critical, so it just checks the 'a'
+// flag each time.  The interpreter calls the template versions directly.
+
+bool Machine::ReadMem(int addr, int size, int *value)
+{
+	if (DebugIsEnabled('a'))
+		return ReadMem<TRUE>(addr, size, value);
+	return ReadMem<FALSE>(addr, size, value);
+}
+
+bool Machine::WriteMem(int addr, int size, int value)
+{
+	if (DebugIsEnabled('a'))
+		return WriteMem<TRUE>(addr, size, value);
+	return WriteMem<FALSE>(addr, size, value);
+}
+
+ExceptionType Machine::Translate(int virtAddr, int *physAddr, int size, bool writing)
+{
+	if (DebugIsEnabled('a'))
+		return Translate<TRUE>(virtAddr, physAddr, size, writing);
+	return Translate<FALSE>(virtAddr, physAddr, size, writing);
+}
+
+// Both versions are needed by the interpreter, in mipssim.cc.
+template bool Machine::ReadMem<TRUE>(int addr, int size, int *value);
+template bool Machine::ReadMem<FALSE>(int addr, int size, int *value);
+template bool Machine::WriteMem<TRUE>(int addr, int size, int value);
+template bool Machine::WriteMem<FALSE>(int addr, int size, int value);
+template ExceptionType Machine::Translate<TRUE>(int virtAddr, int *physAddr, int size, bool writing);
+template ExceptionType Machine::Translate<FALSE>(int virtAddr, int *physAddr, int size, bool writing);
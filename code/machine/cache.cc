@@ -0,0 +1,129 @@
+// cache.cc
+//	Routines to emulate a level of set-associative memory cache.
+//	See cache.h for details.
+//
+//	As in the TLB, the "clock" used for LRU and FIFO is a count of
+//	accesses, and random replacement has its own generator.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "cache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Cache::Cache
+// 	Initialize an empty cache.
+//
+//	"which" -- the level this is, for the statistics
+//	"numRows", "ways", "lineBytes" -- the number of sets, the lines
+//		per set, and the bytes per line; "lineBytes" must be a
+//		power of two, at least a word
+//	"replace" -- which line of a full set to replace
+//	"missTicks" -- how long it takes to fetch a line from the next level
+//	"nextLevel" -- the cache behind this one, or NULL for main memory
+//----------------------------------------------------------------------
+
+Cache::Cache(CacheLevel which, int numRows, int ways, int lineBytes,
+	     ReplacePolicy replace, int missTicks, Cache *nextLevel)
+{
+    ASSERT((numRows > 0) && (ways > 0));
+    ASSERT((lineBytes >= 4) && ((lineBytes & (lineBytes - 1)) == 0));
+
+    level = which;
+    rows = numRows;
+    assoc = ways;
+    lineSize = lineBytes;
+    policy = replace;
+    missTime = missTicks;
+    next = nextLevel;
+    tags = new int[rows * assoc];
+    dirty = new bool[rows * assoc];
+    stamps = new unsigned int[rows * assoc];
+    for (int i = 0; i < rows * assoc; i++) {
+	tags[i] = -1;
+	dirty[i] = FALSE;
+	stamps[i] = 0;
+    }
+    clock = 0;
+    seed = 1;
+}
+
+//----------------------------------------------------------------------
+// Cache::~Cache
+// 	De-allocate the cache (but not the next level).
+//----------------------------------------------------------------------
+
+Cache::~Cache()
+{
+    delete [] tags;
+    delete [] dirty;
+    delete [] stamps;
+}
+
+//----------------------------------------------------------------------
+// Cache::Access
+// 	Look up the line holding physical address "physAddr".  On a miss,
+//	the line is fetched from the next level (or memory), replacing
+//	an empty line of its set if there is one, and otherwise a victim
+//	chosen by the replacement policy.  A dirty victim is written back
+//	to the next level; write buffering hides the time that takes, but
+//	the next level still sees the access.
+//
+//	Returns the number of ticks the access stalls the processor for:
+//	0 for a hit, otherwise the time to fetch the line.
+//
+//	"physAddr" -- the physical address being read or written
+//	"writing" -- if TRUE, the line is marked dirty
+//----------------------------------------------------------------------
+
+int
+Cache::Access(int physAddr, bool writing)
+{
+    int line = (unsigned) physAddr / lineSize;
+    int first = (line % rows) * assoc;
+    int victim = -1, stall, i;
+
+    clock++;
+    for (i = first; i < first + assoc; i++)
+	if (tags[i] == line) {
+	    stats->numCacheHits[level]++;
+	    if (policy == LRUReplace)
+		stamps[i] = clock;
+	    if (writing)
+		dirty[i] = TRUE;
+	    return 0;
+	}
+
+    stats->numCacheMisses[level]++;
+    stall = missTime;
+    if (next != NULL)
+	stall += next->Access(physAddr, FALSE);
+
+    for (i = first; i < first + assoc; i++)
+	if (tags[i] == -1) {
+	    victim = i;
+	    break;
+	}
+    if (victim == -1) {
+	if (policy == RandomReplace) {
+	    seed = seed * 1103515245 + 12345;
+	    victim = first + (seed >> 16) % assoc;
+	} else {			// LRU or FIFO: the oldest stamp
+	    victim = first;
+	    for (i = first + 1; i < first + assoc; i++)
+		if (stamps[i] < stamps[victim])
+		    victim = i;
+	}
+	if (dirty[victim] && (next != NULL))
+	    (void) next->Access(tags[victim] * lineSize, TRUE);
+    }
+    tags[victim] = line;
+    dirty[victim] = writing;
+    stamps[victim] = clock;
+    return stall;
+}
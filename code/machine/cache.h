@@ -0,0 +1,59 @@
+// cache.h
+//	Data structures to emulate the memory caches of the simulated
+//	workstation: split level 1 instruction and data caches, and an
+//	optional unified level 2 cache behind them.
+//
+//	Caches are physically indexed and tagged, write-back and
+//	write-allocate.  Only which lines are present is modelled, not
+//	their contents (mainMemory is always up to date); what a cache
+//	adds to the simulation is the time a miss takes.  A hit in the
+//	level 1 caches is free, since it is already part of UserTick.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "stats.h"
+#include "tlb.h"
+
+// The following class defines one level of set-associative cache.
+// It has "rows" sets of "assoc" lines each, of "lineSize" bytes.
+
+class Cache {
+  public:
+    Cache(CacheLevel which, int numRows, int ways, int lineBytes,
+	  ReplacePolicy replace, int missTicks, Cache *nextLevel);
+				// Initialize an empty cache; a miss takes
+				// "missTicks" ticks, plus the time taken by
+				// "nextLevel" (if any)
+    ~Cache();			// De-allocate it
+
+    int Access(int physAddr, bool writing);
+				// Look up the line holding "physAddr",
+				// loading it on a miss; return the number
+				// of ticks the access stalls for
+
+  private:
+    CacheLevel level;		// which statistics to update
+    int rows;			// number of sets
+    int assoc;			// lines per set
+    int lineSize;		// bytes per line
+    ReplacePolicy policy;	// how to choose a victim
+    int missTime;		// ticks to fetch a line from the next level
+    Cache *next;		// the next level, or NULL for main memory
+
+    int *tags;			// line number held by each line, -1 if none
+    bool *dirty;		// TRUE if the line was written since loaded
+    unsigned int *stamps;	// time of last use (LRU) or of load (FIFO)
+    unsigned int clock;		// advanced on every access
+    unsigned int seed;		// for RandomReplace
+};
+
+#endif // CACHE_H
@@ -22,6 +22,8 @@ static void ConsoleReadPoll(_int c)
 { Console *console = (Console *)c; console->CheckCharAvail(); }
 static void ConsoleWriteDone(_int c)
 { Console *console = (Console *)c; console->WriteDone(); }
+static void ConsoleReadReady(_int c)
+{ Console *console = (Console *)c; console->ReadReady(); }
 
 //----------------------------------------------------------------------
 // Console::Console
@@ -55,8 +57,8 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
     putBusy = FALSE;
     incoming = EOF;
 
-    // start polling for incoming packets
-    interrupt->Schedule(ConsoleReadPoll, (_int)this, ConsoleTime, ConsoleReadInt);
+    // start looking for incoming characters
+    ArmRead();
 }
 
 //----------------------------------------------------------------------
@@ -70,6 +72,39 @@ Console::~Console()
 	Close(readFileNo);
     if (writeFileNo != 1)
 	Close(writeFileNo);
+    interrupt->Cancel(readPoll);
+    UnwatchFile(readFileNo);
+}
+
+//----------------------------------------------------------------------
+// Console::ArmRead
+// 	Get ready for the next character from the keyboard.  Either poll
+//	for it in ConsoleTime ticks, or, unless devices are to poll, ask
+//	the host to tell us (ReadReady) when there is one.
+//----------------------------------------------------------------------
+
+void
+Console::ArmRead()
+{
+    if (interrupt->PolledIO())
+	readPoll = interrupt->Schedule(ConsoleReadPoll, (_int)this,
+				       ConsoleTime, ConsoleReadInt);
+    else
+	WatchFile(readFileNo, ConsoleReadReady, (_int)this);
+}
+
+//----------------------------------------------------------------------
+// Console::ReadReady
+// 	Called when the host has input for the keyboard.  The character
+//	arrives ConsoleTime ticks later, when CheckCharAvail reads it in.
+//----------------------------------------------------------------------
+
+void
+Console::ReadReady()
+{
+    UnwatchFile(readFileNo);
+    readPoll = interrupt->Schedule(ConsoleReadPoll, (_int)this, ConsoleTime,
+				   ConsoleReadInt);
 }
 
 //----------------------------------------------------------------------
@@ -81,6 +116,10 @@ Console::~Console()
 //	character has been grabbed out of the buffer by the Nachos kernel).
 //	Invoke the "read" interrupt handler, once the character has been 
 //	put into the buffer. 
+//
+//	Polling (or watching the host for input) stops while a character
+//	is buffered, since there is no room for another; GetChar starts
+//	it again.
 //----------------------------------------------------------------------
 
 void
@@ -88,17 +127,16 @@ Console::CheckCharAvail()
 {
     char c;
 
-    // schedule the next time to poll for a packet
-    interrupt->Schedule(ConsoleReadPoll, (_int)this, ConsoleTime, 
-			ConsoleReadInt);
-
-    // do nothing if character is already buffered, or none to be read
-    if ((incoming != EOF) || !PollFile(readFileNo))
+    // do nothing if none to be read, except look again
+    if (!PollFile(readFileNo)) {
+	ArmRead();
 	return;	  
+    }
 
     // otherwise, read character and tell user about it
     Read(readFileNo, &c, sizeof(char));
     incoming = c ;
+    incomingTime = stats->totalTicks;
     stats->numConsoleCharsRead++;
     (*readHandler)(handlerArg);	
 }
@@ -115,6 +153,7 @@ Console::WriteDone()
 {
     putBusy = FALSE;
     stats->numConsoleCharsWritten++;
+    stats->latency[ConsoleWriteLatency].Record(stats->totalTicks - putTime);
     (*writeHandler)(handlerArg);
 }
 
@@ -129,7 +168,12 @@ Console::GetChar()
 {
    char ch = incoming;
 
+   if (ch != EOF)
+       stats->latency[ConsoleReadLatency].Record(stats->totalTicks -
+						 incomingTime);
    incoming = EOF;
+   if (!interrupt->IsPending(readPoll))	// there is room again; resume
+       ArmRead();
    return ch;
 }
 
@@ -145,6 +189,7 @@ Console::PutChar(char ch)
     ASSERT(putBusy == FALSE);
     WriteFile(writeFileNo, &ch, sizeof(char));
     putBusy = TRUE;
+    putTime = stats->totalTicks;
     interrupt->Schedule(ConsoleWriteDone, (_int)this, ConsoleTime,
 					ConsoleWriteInt);
 }
@@ -25,6 +25,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "interrupt.h"
 
 // The following class defines a hardware console device.
 // Input and output to the device is simulated by reading 
@@ -55,8 +56,11 @@ class Console {
 // internal emulation routines -- DO NOT call these. 
     void WriteDone();	 	// internal routines to signal I/O completion
     void CheckCharAvail();
+    void ReadReady();		// the host says there is input
 
   private:
+    void ArmRead();		// get ready for the next character
+
     int readFileNo;			// UNIX file emulating the keyboard 
     int writeFileNo;			// UNIX file emulating the display
     VoidFunctionPtr writeHandler; 	// Interrupt handler to call when 
@@ -70,6 +74,10 @@ class Console {
     char incoming;    			// Contains the character to be read,
 					// if there is one available. 
 					// Otherwise contains EOF.
+    IntHandle readPoll;			// The next poll for a character; not
+					// pending while one is buffered
+    long long putTime;			// When the PutChar was started
+    long long incomingTime;		// When "incoming" arrived
 };
 
 #endif // CONSOLE_H
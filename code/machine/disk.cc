@@ -129,6 +129,7 @@ Disk::ReadRequest(int sectorNumber, char* data)
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskReads++;
+    stats->latency[DiskLatency].Record(ticks);
     interrupt->Schedule(DiskDone, (_int) this, ticks, DiskInt);
 }
 
@@ -149,6 +150,7 @@ Disk::WriteRequest(int sectorNumber, char* data)
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskWrites++;
+    stats->latency[DiskLatency].Record(ticks);
     interrupt->Schedule(DiskDone, (_int) this, ticks, DiskInt);
 }
 
@@ -208,6 +210,18 @@ Disk::ModuloDiff(int to, int from)
     return ((toOffset - fromOffset) + SectorsPerTrack) % SectorsPerTrack;
 }
 
+//----------------------------------------------------------------------
+// SectorUnder
+// 	Return which sector of a track is under the disk head at time "when"
+//	(if there has been no seek since).
+//----------------------------------------------------------------------
+
+static int
+SectorUnder(long long when)
+{
+    return (int) ((when / RotationTime) % SectorsPerTrack);
+}
+
 //----------------------------------------------------------------------
 // Disk::ComputeLatency()
 // 	Return how long will it take to read/write a disk sector, from
@@ -234,19 +248,19 @@ Disk::ComputeLatency(int newSector, bool writing)
 {
     int rotation;
     int seek = TimeToSeek(newSector, &rotation);
-    int timeAfter = stats->totalTicks + seek + rotation;
+    long long timeAfter = stats->totalTicks + seek + rotation;
 
 #ifndef NOTRACKBUF	// turn this on if you don't want the track buffer stuff
     // check if track buffer applies
     if ((writing == FALSE) && (seek == 0) 
 		&& (((timeAfter - bufferInit) / RotationTime) 
-	     		> ModuloDiff(newSector, bufferInit / RotationTime))) {
+	     		> ModuloDiff(newSector, SectorUnder(bufferInit)))) {
         DEBUG('d', "Request latency = %d\n", RotationTime);
 	return RotationTime; // time to transfer sector from the track buffer
     }
 #endif
 
-    rotation += ModuloDiff(newSector, timeAfter / RotationTime) * RotationTime;
+    rotation += ModuloDiff(newSector, SectorUnder(timeAfter)) * RotationTime;
 
     DEBUG('d', "Request latency = %d\n", seek + rotation + RotationTime);
     return(seek + rotation + RotationTime);
@@ -267,5 +281,5 @@ Disk::UpdateLast(int newSector)
     if (seek != 0)
 	bufferInit = stats->totalTicks + seek + rotate;
     lastSector = newSector;
-    DEBUG('d', "Updating last sector = %d, %d\n", lastSector, bufferInit);
+    DEBUG('d', "Updating last sector = %d, %lld\n", lastSector, bufferInit);
 }
@@ -82,7 +82,7 @@ class Disk {
     _int handlerArg;			// Argument to interrupt handler 
     bool active;     			// Is a disk operation in progress?
     int lastSector;			// The previous disk request 
-    int bufferInit;			// When the track buffer started 
+    long long bufferInit;		// When the track buffer started 
 					// being loaded
 
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
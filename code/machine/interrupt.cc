@@ -24,6 +24,13 @@
 #include "interrupt.h"
 #include "system.h"
 
+#define NothingPending	0x7fffffffffffffffLL	// nextDue, when no interrupt
+						// is pending
+#define InitialPending	16		// initial size of the pending heap
+#define IOCheckTime	100		// how often to look for host input
+					// while there are threads to run,
+					// if devices don't poll for it
+
 // String definitions for debugging messages
 
 static char *intLevelNames[] = { "off", "on"};
@@ -41,13 +48,71 @@ static char *intTypeNames[] = { "timer", "disk", "console write",
 //	"kind" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
 
-PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, _int param, int time, 
-				IntType kind)
+PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, _int param,
+				   long long time, IntType kind)
 {
     handler = func;
     arg = param;
     when = time;
     type = kind;
+    order = 0;
+    index = -1;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// Earlier
+// 	Return TRUE if interrupt "a" is to fire before interrupt "b": it
+//	is due earlier, or at the same time but was scheduled first.
+//	Breaking ties this way keeps the simulation deterministic.
+//----------------------------------------------------------------------
+
+static inline bool
+Earlier(PendingInterrupt *a, PendingInterrupt *b)
+{
+    return (a->when < b->when) || ((a->when == b->when) && 
+				   ((int) (a->order - b->order) < 0));
+}
+
+//----------------------------------------------------------------------
+// SiftUp, SiftDown
+// 	Restore the heap order of "heap", an array of "size" interrupts
+//	in which heap[i] fires no later than heap[2i+1] and heap[2i+2],
+//	after the entry at "i" has been added or replaced.  Each entry
+//	keeps track of its index, so it can be found to be cancelled.
+//----------------------------------------------------------------------
+
+static void
+SiftUp(PendingInterrupt **heap, int i)
+{
+    PendingInterrupt *toOccur = heap[i];
+
+    while ((i > 0) && Earlier(toOccur, heap[(i - 1) / 2])) {
+	heap[i] = heap[(i - 1) / 2];
+	heap[i]->index = i;
+	i = (i - 1) / 2;
+    }
+    heap[i] = toOccur;
+    toOccur->index = i;
+}
+
+static void
+SiftDown(PendingInterrupt **heap, int size, int i)
+{
+    PendingInterrupt *toOccur = heap[i];
+    int child;
+
+    while ((child = 2 * i + 1) < size) {
+	if ((child + 1 < size) && Earlier(heap[child + 1], heap[child]))
+	    child++;			// the earlier of the two children
+	if (!Earlier(heap[child], toOccur))
+	    break;
+	heap[i] = heap[child];
+	heap[i]->index = i;
+	i = child;
+    }
+    heap[i] = toOccur;
+    toOccur->index = i;
 }
 
 //----------------------------------------------------------------------
@@ -60,10 +125,18 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, _int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    maxPending = InitialPending;
+    pending = new PendingInterrupt *[maxPending];
+    numPending = 0;
+    numScheduled = 0;
+    freePool = NULL;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+    interruptedStatus = SystemMode;
+    nextDue = NothingPending;
+    polledIO = FALSE;
+    nextIOCheck = 0;
 }
 
 //----------------------------------------------------------------------
@@ -73,9 +146,16 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-	delete pending->Remove();
-    delete pending;
+    PendingInterrupt *toOccur;
+
+    for (int i = 0; i < numPending; i++)
+	delete pending[i];
+    delete [] pending;
+    while (freePool != NULL) {
+	toOccur = freePool;
+	freePool = toOccur->next;
+	delete toOccur;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -160,14 +240,21 @@ Interrupt::OneTick()
 	stats->totalTicks += UserTick;
 	stats->userTicks += UserTick;
     }
-    DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
+    DEBUG('i', "\n== Tick %lld ==\n", stats->totalTicks);
+    stats->CheckExport();
 
 // check any pending interrupts are now ready to fire
     ChangeLevel(IntOn, IntOff);		// first, turn off interrupts
 					// (interrupt handlers run with
 					// interrupts disabled)
+    if (!polledIO && (stats->totalTicks >= nextIOCheck)) {
+	nextIOCheck = stats->totalTicks + IOCheckTime;
+	(void) WaitForFiles(0);		// if input has arrived on the host,
+					// its device schedules an interrupt
+    }
     while (CheckIfDue(FALSE))		// check for pending interrupts
 	;
+    FindNextDue();
     ChangeLevel(IntOff, IntOn);		// re-enable interrupts
     if (yieldOnReturn) {		// if the timer device handler asked 
 					// for a context switch, ok to do it now
@@ -204,6 +291,10 @@ Interrupt::YieldOnReturn()
 //	on the ready queue, the only thing to do is to advance 
 //	simulated time until the next scheduled hardware interrupt.
 //
+//	If devices are waiting for input on the host, and no interrupt
+//	other than the timer is pending, first wait (in real time) for
+//	some to arrive; simulated time stands still meanwhile.
+//
 //	If there are no pending interrupts, stop.  There's nothing
 //	more for us to do.
 //----------------------------------------------------------------------
@@ -212,9 +303,12 @@ Interrupt::Idle()
 {
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IdleMode;
+    if (!polledIO && WatchingFiles())
+	(void) WaitForFiles(IOPending() ? 0 : -1);
     if (CheckIfDue(TRUE)) {		// check for any pending interrupts
     	while (CheckIfDue(FALSE))	// check for any other pending 
 	    ;				// interrupts
+	FindNextDue();
         yieldOnReturn = FALSE;		// since there's nothing in the
 					// ready queue, the yield is automatic
         status = SystemMode;
@@ -235,13 +329,15 @@ Interrupt::Idle()
 
 //----------------------------------------------------------------------
 // Interrupt::Halt
-// 	Shut down Nachos cleanly, printing out performance statistics.
+// 	Shut down Nachos cleanly, printing out performance statistics
+//	(and writing them to the export file, if there is one).
 //----------------------------------------------------------------------
 void
 Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
     stats->Print();
+    stats->FinishExport();
     Cleanup();     // Never returns.
 }
 
@@ -250,28 +346,240 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: put it on a binary heap, so this takes time
+//	logarithmic in the number of pending interrupts, and reuse a
+//	PendingInterrupt from the pool when there is one.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
 //
+//	Returns a handle, with which the device can cancel the interrupt
+//	or move it, rather than having to let it occur.
+//
 //	"handler" is the procedure to call when the interrupt occurs
 //	"arg" is the argument to pass to the procedure
 //	"fromNow" is how far in the future (in simulated time) the 
 //		 interrupt is to occur
 //	"type" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
-void
+IntHandle
 Interrupt::Schedule(VoidFunctionPtr handler, _int arg, int fromNow, IntType type)
 {
-    int when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
+    long long when = stats->totalTicks + fromNow;
+    PendingInterrupt *toOccur;
+    IntHandle handle;
 
-    DEBUG('i', "Scheduling interrupt handler the %s at time = %d\n", 
+    DEBUG('i', "Scheduling interrupt handler the %s at time = %lld\n", 
 					intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    if (freePool != NULL) {
+	toOccur = freePool;
+	freePool = toOccur->next;
+	toOccur->handler = handler;
+	toOccur->arg = arg;
+	toOccur->when = when;
+	toOccur->type = type;
+    } else
+	toOccur = new PendingInterrupt(handler, arg, when, type);
+    toOccur->order = numScheduled++;
+    Insert(toOccur);
+    if (when < nextDue)
+	nextDue = when;
+    handle.pending = toOccur;
+    handle.order = toOccur->order;
+    return handle;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::IsPending
+// 	Return TRUE if the interrupt "handle" refers to is still to occur:
+//	it has neither fired nor been cancelled.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::IsPending(IntHandle handle)
+{
+    return (handle.pending != NULL) && (handle.pending->index >= 0) &&
+	(handle.pending->order == handle.order);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Take the interrupt "handle" refers to off the pending heap, so it
+//	never occurs.  Returns FALSE if it has already occurred (or been
+//	cancelled).
+//
+//	"nextDue" is left alone; it may now be too early, which only
+//	means OneTick looks at the heap again a little sooner.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::Cancel(IntHandle handle)
+{
+    PendingInterrupt *toOccur = handle.pending;
+
+    if (!IsPending(handle))
+	return FALSE;
+    DEBUG('i', "Cancelling interrupt handler the %s at time = %lld\n",
+	  intTypeNames[toOccur->type], toOccur->when);
+    Remove(toOccur);
+    toOccur->next = freePool;
+    freePool = toOccur;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Reschedule
+// 	Move the interrupt "handle" refers to so that it occurs "fromNow"
+//	ticks from now, instead of when it was going to.  Among interrupts
+//	due at the same time, it keeps the place it was scheduled in.
+//	Returns FALSE (and does nothing) if it has already occurred.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::Reschedule(IntHandle handle, int fromNow)
+{
+    PendingInterrupt *toOccur = handle.pending;
+
+    ASSERT(fromNow > 0);
+    if (!IsPending(handle))
+	return FALSE;
+    toOccur->when = stats->totalTicks + fromNow;
+    DEBUG('i', "Rescheduling interrupt handler the %s at time = %lld\n",
+	  intTypeNames[toOccur->type], toOccur->when);
+    Reposition(toOccur->index);
+    if (toOccur->when < nextDue)
+	nextDue = toOccur->when;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Insert
+// 	Add "toOccur" to the heap of pending interrupts, doubling the
+//	heap if it is full.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Insert(PendingInterrupt *toOccur)
+{
+    if (numPending == maxPending) {
+	PendingInterrupt **bigger = new PendingInterrupt *[maxPending * 2];
+
+	bcopy(pending, bigger, numPending * sizeof(PendingInterrupt *));
+	delete [] pending;
+	pending = bigger;
+	maxPending *= 2;
+    }
+    pending[numPending] = toOccur;
+    SiftUp(pending, numPending++);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::RemoveFirst
+// 	Take the interrupt that is to fire first off the pending heap,
+//	and return it (NULL if nothing is pending).
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+Interrupt::RemoveFirst()
+{
+    PendingInterrupt *first;
+
+    if (numPending == 0)
+	return NULL;
+    first = pending[0];
+    Remove(first);
+    return first;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Remove
+// 	Take "toOccur" off the pending heap, wherever it is, by moving
+//	the last entry into its place.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Remove(PendingInterrupt *toOccur)
+{
+    int i = toOccur->index;
+
+    ASSERT((i >= 0) && (i < numPending) && (pending[i] == toOccur));
+    toOccur->index = -1;
+    if (i < --numPending) {
+	pending[i] = pending[numPending];
+	Reposition(i);
+    }
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Reposition
+// 	Move the entry at "i" of the pending heap up or down, as needed,
+//	after its time (or the entry itself) has changed.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Reposition(int i)
+{
+    if ((i > 0) && Earlier(pending[i], pending[(i - 1) / 2]))
+	SiftUp(pending, i);
+    else
+	SiftDown(pending, numPending, i);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::IOPending
+// 	Return TRUE if an interrupt from some device other than the timer
+//	is pending -- that is, if a disk, console or network operation is
+//	in progress.  Such an operation can't be saved in a checkpoint.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::IOPending()
+{
+    for (int i = 0; i < numPending; i++)
+	if (pending[i]->type != TimerInt)
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::ShiftPending
+// 	Make every pending interrupt occur "delta" ticks later than it
+//	was going to.  Used when simulated time is set forward by
+//	restoring a checkpoint, so that devices keep their place relative
+//	to the new time, rather than all falling due at once.  Moving
+//	them all by the same amount doesn't change their order.
+//----------------------------------------------------------------------
+
+void
+Interrupt::ShiftPending(long long delta)
+{
+    for (int i = 0; i < numPending; i++)
+	pending[i]->when += delta;
+    FindNextDue();
+}
+
+//----------------------------------------------------------------------
+// Interrupt::FindNextDue
+// 	Recompute "nextDue", after CheckIfDue has taken interrupts off the
+//	pending heap.  In between, Schedule only ever moves it earlier, so
+//	it never claims that an interrupt is further off than it is.
+//	OneTick also needs to be called when it is time to check the host
+//	for input, or to export the statistics.
+//----------------------------------------------------------------------
+
+void
+Interrupt::FindNextDue()
+{
+    if (numPending == 0)
+	nextDue = NothingPending;
+    else
+	nextDue = pending[0]->when;
+    if (!polledIO && WatchingFiles() && (nextIOCheck < nextDue))
+	nextDue = nextIOCheck;		// time to look for host input
+    if (stats->NextExport() < nextDue)
+	nextDue = stats->NextExport();	// or to export the statistics
 }
 
 //----------------------------------------------------------------------
@@ -291,47 +599,46 @@ bool
 Interrupt::CheckIfDue(bool advanceClock)
 {
     MachineStatus old = status;
-    int when;
+    PendingInterrupt *toOccur;
+    long long when;
 
     ASSERT(level == IntOff);		// interrupts need to be disabled,
 					// to invoke an interrupt handler
     if (DebugIsEnabled('i'))
 	DumpState();
-    PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
-
-    if (toOccur == NULL)		// no pending interrupts
+    if (numPending == 0)		// no pending interrupts
 	return FALSE;			
+    toOccur = pending[0];
+    when = toOccur->when;
 
     if (advanceClock && when > stats->totalTicks) {	// advance the clock
 	stats->idleTicks += (when - stats->totalTicks);
 	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
+    } else if (when > stats->totalTicks)	// not time yet, leave it
 	return FALSE;
-    }
 
 // Check if there is nothing more to do, and if so, quit
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
-				&& pending->IsEmpty()) {
-	 pending->SortedInsert(toOccur, when);
+				&& (numPending == 1))
 	 return FALSE;
-    }
+    (void) RemoveFirst();
 
-    DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
+    DEBUG('i', "Invoking interrupt handler for the %s at time %lld\n", 
 			intTypeNames[toOccur->type], toOccur->when);
 #ifdef USER_PROGRAM
     if (machine != NULL)
     	machine->DelayedLoad(0, 0);
 #endif
     inHandler = TRUE;
+    interruptedStatus = old;
     status = SystemMode;			// whatever we were doing,
 						// we are now going to be
 						// running in the kernel
     (*(toOccur->handler))(toOccur->arg);	// call the interrupt handler
     status = old;				// restore the machine status
     inHandler = FALSE;
-    delete toOccur;
+    toOccur->next = freePool;			// keep it for reuse
+    freePool = toOccur;
     return TRUE;
 }
 
@@ -342,11 +649,9 @@ Interrupt::CheckIfDue(bool advanceClock)
 //----------------------------------------------------------------------
 
 static void
-PrintPending(_int arg)
+PrintPending(PendingInterrupt *pend)
 {
-    PendingInterrupt *pend = (PendingInterrupt *)arg;
-
-    printf("Interrupt handler %s, scheduled at %d\n", 
+    printf("Interrupt handler %s, scheduled at %lld\n", 
 	intTypeNames[pend->type], pend->when);
 }
 
@@ -359,11 +664,106 @@ PrintPending(_int arg)
 void
 Interrupt::DumpState()
 {
-    printf("Time: %d, interrupts %s\n", stats->totalTicks, 
+    printf("Time: %lld, interrupts %s\n", stats->totalTicks, 
 					intLevelNames[level]);
     printf("Pending interrupts:\n");
     fflush(stdout);
-    pending->Mapcar(PrintPending);
+    if (numPending > 0) {		// in the order they will fire
+	PendingInterrupt **sorted = new PendingInterrupt *[numPending];
+	int i, j;
+
+	for (i = 0; i < numPending; i++) {	// insertion sort a copy
+	    for (j = i; (j > 0) && Earlier(pending[i], sorted[j - 1]); j--)
+		sorted[j] = sorted[j - 1];
+	    sorted[j] = pending[i];
+	}
+	for (i = 0; i < numPending; i++)
+	    PrintPending(sorted[i]);
+	delete [] sorted;
+    }
     printf("End of pending interrupts\n");
     fflush(stdout);
 }
+
+// State of the interrupt queue benchmark: how many of its interrupts
+// have fired, and its own random number generator, so that it doesn't
+// disturb the random yields (-rs) of the rest of the simulation.
+static int benchFired;
+static unsigned int benchSeed;
+
+#define BenchSpread	1000	// benchmark interrupts are due within
+				// this many ticks of being scheduled
+
+//----------------------------------------------------------------------
+// BenchHandler
+// 	Handler for the interrupts of Interrupt::Benchmark: count it, and
+//	schedule another, so the number pending stays the same.  Many are
+//	due at the same time, which exercises the tie-breaking as well.
+//----------------------------------------------------------------------
+
+static void
+BenchHandler(_int arg)
+{
+    benchFired++;
+    benchSeed = benchSeed * 1103515245 + 12345;
+    interrupt->Schedule(BenchHandler, arg, 1 + (benchSeed >> 16) % BenchSpread,
+			TimerInt);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Benchmark
+// 	Measure how fast interrupts can be scheduled and fired: keep
+//	"depth" interrupts pending, and fire "events" of them, timing the
+//	whole thing on the host clock.  The pending interrupts of the
+//	simulation, and the simulated clock, are set aside meanwhile, so
+//	the benchmark doesn't change what happens afterwards.
+//
+//	"events" -- the number of interrupts to fire (and schedule)
+//	"depth" -- the number of interrupts to keep pending
+//----------------------------------------------------------------------
+
+void
+Interrupt::Benchmark(int events, int depth)
+{
+    PendingInterrupt **savedPending = pending;
+    int savedNum = numPending, savedMax = maxPending;
+    long long savedDue = nextDue;
+    long long savedTicks = stats->totalTicks, savedIdle = stats->idleTicks;
+    IntStatus oldLevel = level;
+    double start, elapsed;
+
+    ASSERT((events > 0) && (depth > 0));
+    maxPending = InitialPending;
+    pending = new PendingInterrupt *[maxPending];
+    numPending = 0;
+    ChangeLevel(oldLevel, IntOff);
+    benchFired = 0;
+    benchSeed = 1;
+
+    start = HostSeconds();
+    for (int i = 0; i < depth; i++)
+	BenchHandler(0);
+    benchFired = 0;
+    while (benchFired < events)
+	(void) CheckIfDue(TRUE);
+    elapsed = HostSeconds() - start;
+
+    printf("Interrupt queue: %d interrupts at depth %d in %.3f seconds, "
+	   "%.0f per second\n", events, depth, elapsed,
+	   (elapsed > 0) ? events / elapsed : 0.0);
+
+    while (numPending > 0) {		// put everything back
+	PendingInterrupt *toOccur = RemoveFirst();
+
+	toOccur->next = freePool;
+	freePool = toOccur;
+    }
+    delete [] pending;
+    pending = savedPending;
+    numPending = savedNum;
+    maxPending = savedMax;
+    nextDue = savedDue;
+    stats->totalTicks = savedTicks;
+    stats->idleTicks = savedIdle;
+    ChangeLevel(IntOff, oldLevel);
+}
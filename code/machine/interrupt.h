@@ -58,15 +58,36 @@ enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt,
 
 class PendingInterrupt {
   public:
-    PendingInterrupt(VoidFunctionPtr func, _int param, int time, IntType kind);
+    PendingInterrupt(VoidFunctionPtr func, _int param, long long time,
+		     IntType kind);
 				// initialize an interrupt that will
 				// occur in the future
 
     VoidFunctionPtr handler;    // The function (in the hardware device
 				// emulator) to call when the interrupt occurs
     _int arg;           // The argument to the function.
-    int when;			// When the interrupt is supposed to fire
+    long long when;		// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    unsigned int order;		// When it was scheduled, relative to the
+				// others: interrupts due at the same time
+				// fire in the order they were scheduled
+    int index;			// Where it is in the pending heap, or -1
+				// if it has fired or been cancelled
+    PendingInterrupt *next;	// Next one in the pool of free ones
+};
+
+// The following class defines a handle on a scheduled interrupt,
+// returned by Interrupt::Schedule, with which a device can cancel the
+// interrupt or move it to a new time.  A handle can safely be kept after
+// its interrupt has fired or been cancelled; it then refers to nothing.
+
+class IntHandle {
+  public:
+    IntHandle() { pending = NULL; order = 0; }
+
+    PendingInterrupt *pending;	// The interrupt, if it is still pending
+    unsigned int order;		// Its "order"; the PendingInterrupt is
+				// reused with a new one once it is done
 };
 
 // The following class defines the data structures for the simulation
@@ -97,6 +118,10 @@ class Interrupt {
 
     MachineStatus getStatus() { return status; } // idle, kernel, user
     void setStatus(MachineStatus st) { status = st; }
+    MachineStatus InterruptedStatus() { return interruptedStatus; }
+					// In an interrupt handler: what the
+					// machine was doing when interrupted
+					// (getStatus is then SystemMode)
 
     void DumpState();			// Print interrupt state
     
@@ -106,25 +131,75 @@ class Interrupt {
     // but they need to be public since they are called by the
     // hardware device simulators.
 
-    void Schedule(VoidFunctionPtr handler,// Schedule an interrupt to occur
-	_int arg, int when, IntType type);// at time ``when''.  This is called
-    					// by the hardware device simulators.
+    IntHandle Schedule(VoidFunctionPtr handler,// Schedule an interrupt to 
+	_int arg, int when, IntType type);// occur at time ``when''.  This is
+    					// called by the hardware device
+					// simulators.
+    bool IsPending(IntHandle handle);	// Is "handle" still to occur?
+    bool Cancel(IntHandle handle);	// Make sure it doesn't; FALSE if
+					// it had already occurred
+    bool Reschedule(IntHandle handle, int fromNow);
+					// Make it occur at a new time
+					// instead; FALSE if it had already
+					// occurred
     
     void OneTick();       		// Advance simulated time
 
+    long long NextDue() { return nextDue; }	// No pending interrupt is due
+					// before this time, so until then
+					// OneTick need only advance the clock
+
+    bool IOPending();			// Is any device other than the
+					// timer due to interrupt?
+    void ShiftPending(long long delta);	// Move every pending interrupt
+					// "delta" ticks later, when the
+					// clock is set (see checkpoints)
+
+    bool PolledIO() { return polledIO; }
+    void SetPolledIO(bool polled) { polledIO = polled; }
+					// Should the console and network
+					// poll for input, rather than being
+					// told of it by the host?  Polling
+					// keeps the old, deterministic,
+					// simulated time behavior
+
+    void Benchmark(int events, int depth);
+					// Time "events" Schedule/CheckIfDue
+					// pairs, with "depth" interrupts
+					// pending, on the host clock
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    List *pending;		// the list of interrupts scheduled
-				// to occur in the future
+    PendingInterrupt **pending;	// the interrupts scheduled to occur
+				// in the future, as a binary heap
+				// ordered by time, then by "order"
+    int numPending;		// the number of them
+    int maxPending;		// the size of "pending"; doubled when full
+    unsigned int numScheduled;	// "order" for the next interrupt
+    PendingInterrupt *freePool;	// PendingInterrupt's to reuse, so
+				// scheduling doesn't allocate memory
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
     MachineStatus status;	// idle, kernel mode, user mode
+    MachineStatus interruptedStatus; // the status when the running
+				// interrupt handler was called
+    long long nextDue;		// lower bound on when the first pending
+				// interrupt is to occur
+    bool polledIO;		// devices poll for input (see PolledIO)
+    long long nextIOCheck;	// when OneTick is next to look for input
+				// on the host, if devices don't poll
 
     // these functions are internal to the interrupt simulation code
 
     bool CheckIfDue(bool advanceClock); // Check if an interrupt is supposed
 					// to occur now
+    void FindNextDue();			// Set nextDue from the pending heap
+    void Insert(PendingInterrupt *toOccur); // Add to the pending heap
+    PendingInterrupt *RemoveFirst();	// Take the earliest off it
+    void Remove(PendingInterrupt *toOccur); // Take any one off it
+    void Reposition(int i);		// Restore the heap order after
+					// changing the time of entry "i"
 
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 	IntStatus now);  		// simulated time
@@ -48,30 +48,69 @@ void CheckEndian()
 // Machine::Machine
 // 	Initialize the simulation of user program execution.
 //
+//	Main memory, and the predecoding tables that shadow it, come from
+//	AllocZeroedArray, so they are zero (FALSE, NULL) to begin with and
+//	only cost host memory for the parts that are used.
+//
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"mode" -- whether to interpret user code one instruction at a time,
+//		or to use the basic block engine (optionally compiling hot
+//		blocks).
+//	"physPages" -- the size of physical memory, in pages
+//	"tlbEntries" -- the number of TLB entries, if there is a TLB
+//	"tlbWays" -- entries per TLB set, or 0 for a fully associative TLB
+//	"tlbPolicy" -- which entry of a full TLB set to replace
+//	"tlbWalk" -- if TRUE, put a TLB in front of the page table, and
+//		refill it in "hardware" rather than trapping to the kernel
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, ExecMode mode, int physPages, int tlbEntries,
+		 int tlbWays, ReplacePolicy tlbPolicy, bool walk)
 {
     int i;
 
+    ASSERT((physPages > 0) && (physPages <= MaxPhysPages));
+    ASSERT(tlbEntries > 0);
+    if (tlbWays == 0)
+	tlbWays = tlbEntries;
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
-    mainMemory = new char[MemorySize];
-    for (i = 0; i < MemorySize; i++)
-      	mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else	// use linear page table
-    tlb = NULL;
-    pageTable = NULL;
+    numPhysPages = physPages;
+    memorySize = physPages * PageSize;
+    mainMemory = AllocZeroedArray(memorySize);
+    decodeCache = (Instruction *)
+	AllocZeroedArray((memorySize / 4) * sizeof(Instruction));
+    decodeValid = (bool *) AllocZeroedArray((memorySize / 4) * sizeof(bool));
+    blockMap = (BasicBlock **)
+	AllocZeroedArray((memorySize / 4) * sizeof(BasicBlock *));
+    pageVersion = (unsigned int *)
+	AllocZeroedArray(numPhysPages * sizeof(unsigned int));
+    FlushSoftTLB();
+    tlbSize = tlbEntries;
+    tlbWalk = walk;
+#ifndef USE_TLB
+    if (!tlbWalk) {		// use linear page table
+	tlbModel = NULL;
+	tlb = NULL;
+    } else
 #endif
+    {
+	tlbModel = new TLB(tlbSize, tlbWays, tlbPolicy);
+	tlb = tlbModel->entries;
+    }
+    pageTable = NULL;
+    pageTableFormat = LinearTable;
+    sparseTable = NULL;
+    invertedTable = NULL;
+    asid = 0;
+    for (i = 0; i < NumCacheLevels; i++)
+	cache[i] = NULL;
+    profiler = NULL;
 
     singleStep = debug;
+    batchTicks = FALSE;
+    execMode = mode;
     CheckEndian();
 }
 
@@ -82,9 +121,29 @@ Machine::Machine(bool debug)
 
 Machine::~Machine()
 {
-    delete [] mainMemory;
-    if (tlb != NULL)
-        delete [] tlb;
+    for (int i = 0; i < memorySize / 4; i++)
+	if (blockMap[i] != NULL) {
+	    if (blockMap[i]->code != NULL)
+		delete [] blockMap[i]->code;
+	    delete blockMap[i];
+	}
+    DeallocZeroedArray(mainMemory, memorySize);
+    DeallocZeroedArray((char *) decodeCache,
+		       (memorySize / 4) * sizeof(Instruction));
+    DeallocZeroedArray((char *) decodeValid, (memorySize / 4) * sizeof(bool));
+    DeallocZeroedArray((char *) blockMap,
+		       (memorySize / 4) * sizeof(BasicBlock *));
+    DeallocZeroedArray((char *) pageVersion,
+		       numPhysPages * sizeof(unsigned int));
+    if (tlbModel != NULL)
+        delete tlbModel;
+    for (int i = 0; i < NumCacheLevels; i++)
+	if (cache[i] != NULL)
+	    delete cache[i];
+    if (invertedTable != NULL)
+	delete invertedTable;
+    if (profiler != NULL)
+	delete profiler;
 }
 
 //----------------------------------------------------------------------
@@ -93,6 +152,9 @@ Machine::~Machine()
 //	the user program either invoked a system call, or some exception
 //	occured (such as the address translation failed).
 //
+//	How long page faults and system calls take to handle is kept in
+//	the latency histograms.
+//
 //	"which" -- the cause of the kernel trap
 //	"badVaddr" -- the virtual address causing the trap, if appropriate
 //----------------------------------------------------------------------
@@ -100,6 +162,8 @@ Machine::~Machine()
 void
 Machine::RaiseException(ExceptionType which, int badVAddr)
 {
+    long long start = stats->totalTicks;
+
     DEBUG('m', "Exception: %s\n", exceptionNames[which]);
     
 //  ASSERT(interrupt->getStatus() == UserMode);
@@ -108,6 +172,10 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
     interrupt->setStatus(UserMode);
+    if (which == PageFaultException)
+	stats->latency[PageFaultLatency].Record(stats->totalTicks - start);
+    else if (which == SyscallException)
+	stats->latency[SyscallLatency].Record(stats->totalTicks - start);
 }
 
 //----------------------------------------------------------------------
@@ -127,7 +195,7 @@ void Machine::Debugger()
 
     interrupt->DumpState();
     DumpState();
-    printf("%d> ", stats->totalTicks);
+    printf("%lld> ", stats->totalTicks);
     fflush(stdout);
     fgets(buf, 80, stdin);
     if (sscanf(buf, "%d", &num) == 1)
@@ -194,6 +262,334 @@ Machine::DumpState()
     printf("\n");
 }
 
+//----------------------------------------------------------------------
+// Machine::UserPage
+// 	Translate user virtual address "virtAddr" for the copy routines,
+//	setting the use (and, if "writing", dirty) bits as an access by
+//	the program would.  If the page isn't in memory, the kernel's page
+//	fault handler is invoked, as it would be for the program, and the
+//	translation retried; that is what lets a copy continue across a
+//	page that is paged in partway through.
+//
+//	Returns the host address of the byte, or NULL if it can't be
+//	mapped (or written, if "writing").
+//----------------------------------------------------------------------
+
+char *
+Machine::UserPage(int virtAddr, bool writing)
+{
+    int physAddr;
+    ExceptionType exception = Translate(virtAddr, &physAddr, 1, writing);
+
+    if (exception == PageFaultException) {
+	MachineStatus oldStatus = interrupt->getStatus();
+
+	RaiseException(exception, virtAddr);
+	interrupt->setStatus(oldStatus);	// still in the kernel
+	exception = Translate(virtAddr, &physAddr, 1, writing);
+    }
+    if (exception != NoException) {
+	DEBUG('a', "Copy to/from user: %s at 0x%x\n",
+	      exceptionNames[exception], virtAddr);
+	return NULL;
+    }
+    return &mainMemory[physAddr];
+}
+
+// The number of bytes from "virtAddr" to the end of its page.
+static int
+PageRemaining(int virtAddr)
+{
+    return PageSize - (unsigned) virtAddr % PageSize;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyFromUser
+// 	Copy "size" bytes at "virtAddr" in the current address space into
+//	kernel buffer "buffer".  Each page is translated once, and then
+//	copied with bcopy, rather than calling ReadMem for every byte.
+//
+//	Returns FALSE if part of the range isn't mapped; "buffer" then
+//	holds whatever was copied before the bad page.
+//----------------------------------------------------------------------
+
+bool
+Machine::CopyFromUser(int virtAddr, char *buffer, int size)
+{
+    while (size > 0) {
+	int chunk = min(size, PageRemaining(virtAddr));
+	char *from = UserPage(virtAddr, FALSE);
+
+	if (from == NULL)
+	    return FALSE;
+	bcopy(from, buffer, chunk);
+	virtAddr += chunk;
+	buffer += chunk;
+	size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyToUser
+// 	Copy "size" bytes from kernel buffer "buffer" to "virtAddr" in
+//	the current address space, a page at a time.  Any predecoded
+//	instructions that are overwritten are invalidated, as WriteMem
+//	does.
+//
+//	Returns FALSE if part of the range isn't mapped, or is read-only.
+//----------------------------------------------------------------------
+
+bool
+Machine::CopyToUser(int virtAddr, char *buffer, int size)
+{
+    while (size > 0) {
+	int chunk = min(size, PageRemaining(virtAddr));
+	char *to = UserPage(virtAddr, TRUE);
+	int physAddr, i;
+
+	if (to == NULL)
+	    return FALSE;
+	physAddr = to - mainMemory;
+	for (i = physAddr / 4; i <= (physAddr + chunk - 1) / 4; i++)
+	    if (decodeValid[i]) {		// overwriting instructions
+		InvalidateDecoded(physAddr, chunk);
+		break;
+	    }
+	bcopy(buffer, to, chunk);
+	virtAddr += chunk;
+	buffer += chunk;
+	size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyStringFromUser
+// 	Copy the null-terminated string at "virtAddr" in the current
+//	address space into "buffer", which holds "maxSize" bytes.  Pages
+//	are copied only up to the null, so a string ending just before
+//	an unmapped page is fine.
+//
+//	Returns FALSE if part of the string isn't mapped, or if it (with
+//	its null) doesn't fit; "buffer" is null-terminated either way.
+//----------------------------------------------------------------------
+
+bool
+Machine::CopyStringFromUser(int virtAddr, char *buffer, int maxSize)
+{
+    int copied = 0;
+
+    ASSERT(maxSize > 0);
+    buffer[0] = '\0';
+    while (copied < maxSize) {
+	int chunk = min(maxSize - copied, PageRemaining(virtAddr));
+	char *from = UserPage(virtAddr, FALSE);
+	char *end;
+
+	if (from == NULL) {
+	    buffer[copied] = '\0';
+	    return FALSE;
+	}
+	end = (char *) memchr(from, '\0', chunk);
+	if (end != NULL) {		// found the end of the string
+	    bcopy(from, buffer + copied, end - from + 1);
+	    return TRUE;
+	}
+	bcopy(from, buffer + copied, chunk);
+	virtAddr += chunk;
+	copied += chunk;
+    }
+    buffer[maxSize - 1] = '\0';		// too long; truncate it
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateDecoded
+// 	Forget any predecoded instructions for the words covering
+//	[physAddr, physAddr + size) of physical memory.  Called by WriteMem,
+//	and by kernel code that fills mainMemory directly, e.g. when
+//	loading a program or reading a page in from the swap file.
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateDecoded(int physAddr, int size)
+{
+    int first = physAddr / 4;
+    int last = (physAddr + size - 1) / 4;
+
+    ASSERT((physAddr >= 0) && ((physAddr + size) <= memorySize));
+    for (int i = first; i <= last; i++)
+	decodeValid[i] = FALSE;
+    for (int i = physAddr / PageSize; i <= (physAddr + size - 1) / PageSize; i++)
+	pageVersion[i]++;		// any blocks on these pages are stale
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushSoftTLB
+// 	Empty the cache of translations used by ReadMem and WriteMem.
+//	Called on every address space switch, and by kernel code that
+//	changes a page table entry or the TLB.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushSoftTLB()
+{
+    for (int i = 0; i < SoftTLBSize; i++)
+	softTLB[i].virtualPage = -1;
+}
+
+//----------------------------------------------------------------------
+// Machine::Checkpoint
+// 	Write the state of the simulated hardware to the host file "fd":
+//	a header describing the machine, then the CPU registers, all of
+//	physical memory, and the statistics (including the clock).
+//
+//	The kernel adds its own state (the address space) after this, and
+//	makes sure that there is nothing else to save: the checkpoint must
+//	be taken at an instruction boundary, with no I/O in progress.
+//	Caches, the TLB and the predecoded instructions are not saved; they
+//	start out cold after a restore.
+//----------------------------------------------------------------------
+
+void
+Machine::Checkpoint(int fd)
+{
+    int header[3];
+
+    header[0] = CheckpointMagic;
+    header[1] = numPhysPages;
+    header[2] = PageSize;
+    WriteFile(fd, (char *) header, sizeof(header));
+    WriteFile(fd, (char *) registers, sizeof(registers));
+    WriteFile(fd, mainMemory, memorySize);
+    WriteFile(fd, (char *) stats, sizeof(Statistics));
+}
+
+//----------------------------------------------------------------------
+// Machine::Restore
+// 	Read back the hardware state written by Checkpoint from the host
+//	file "fd".  Physical memory must be the same size as when the
+//	checkpoint was taken (see -mem).
+//
+//	Returns FALSE, changing nothing, if "fd" doesn't hold a checkpoint
+//	of a machine like this one.
+//----------------------------------------------------------------------
+
+bool
+Machine::Restore(int fd)
+{
+    int header[3];
+
+    if ((ReadPartial(fd, (char *) header, sizeof(header)) != sizeof(header))
+	    || (header[0] != CheckpointMagic) || (header[1] != numPhysPages)
+	    || (header[2] != PageSize))
+	return FALSE;
+    Read(fd, (char *) registers, sizeof(registers));
+    Read(fd, mainMemory, memorySize);
+    Read(fd, (char *) stats, sizeof(Statistics));
+    InvalidateDecoded(0, memorySize);
+    FlushTLB(AllSpaces);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTLB
+// 	Invalidate the TLB entries belonging to address space "id" (or
+//	all of them, if "id" is AllSpaces), along with the soft TLB.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTLB(int id)
+{
+    if (tlbModel != NULL)
+	tlbModel->Invalidate(id);
+    FlushSoftTLB();
+}
+
+//----------------------------------------------------------------------
+// Machine::RefillTLB
+// 	Copy page table entry "pte" of the current address space into the
+//	TLB, on a miss, and charge the time the hardware page table walker
+//	would take to do it.  Returns the new TLB entry.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+Machine::RefillTLB(TranslationEntry *pte)
+{
+    stats->numTLBRefills++;
+    stats->tlbRefillTicks += TLBRefillTime;
+    Stall(TLBRefillTime);
+    return tlbModel->Refill(pte, asid);
+}
+
+//----------------------------------------------------------------------
+// Machine::Stall
+// 	Advance simulated time by "ticks", during which the processor is
+//	waiting on the memory system, and charge it to whichever of user
+//	or kernel code made the access.
+//
+//	The clock is moved directly, as when instructions are batched
+//	(see Interpret); an interrupt that falls due meanwhile is taken
+//	at the next OneTick.
+//----------------------------------------------------------------------
+
+void
+Machine::Stall(int ticks)
+{
+    stats->totalTicks += ticks;
+    if (interrupt->getStatus() == UserMode)
+	stats->userTicks += ticks;
+    else
+	stats->systemTicks += ticks;
+}
+
+//----------------------------------------------------------------------
+// Machine::CacheAccess
+// 	Look up physical address "physAddr" in level 1 cache "level", and
+//	stall for as long as any miss takes.  Callers check that the cache
+//	is simulated first, so that without caches this costs nothing.
+//----------------------------------------------------------------------
+
+void
+Machine::CacheAccess(CacheLevel level, int physAddr, bool writing)
+{
+    int ticks = cache[level]->Access(physAddr, writing);
+
+    if (ticks > 0) {
+	stats->cacheStallTicks += ticks;
+	Stall(ticks);
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::FillSoftTLB
+// 	Remember that "virtAddr" was just translated to "physAddr", so that
+//	later accesses to the same page can bypass Translate.
+//
+//	A translation made for a read leaves the entry read-only, so the
+//	first write to the page still goes through Translate, and sets
+//	the dirty bit.  Only the untraced versions of ReadMem and WriteMem
+//	use the cache, so with address tracing on every access is traced.
+//
+//	With a TLB, nothing is cached: the TLB model has to see every
+//	reference for its replacement policy and statistics to be right.
+//----------------------------------------------------------------------
+
+void
+Machine::FillSoftTLB(int virtAddr, int physAddr, bool writing)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    SoftTLBEntry *entry = &softTLB[vpn % SoftTLBSize];
+
+    if (tlb != NULL)
+	return;
+
+    entry->virtualPage = vpn;
+    entry->page = &mainMemory[(physAddr / PageSize) * PageSize];
+    entry->writable = writing;
+}
+
 //----------------------------------------------------------------------
 // Machine::ReadRegister/WriteRegister
 //   	Fetch or write the contents of a user program register.
@@ -24,17 +24,32 @@
 #include "copyright.h"
 #include "utility.h"
 #include "translate.h"
+#include "tlb.h"
+#include "cache.h"
+#include "profile.h"
+#include "pagetable.h"
 #include "disk.h"
 
+// DEBUG, for use in the interpreter templates that take a "tracing"
+// parameter: in the untraced version the call is compiled out.
+#define TRACE(flag, ...) \
+    do { if (tracing) DEBUG(flag, __VA_ARGS__); } while (0)
+
 // Definitions related to the size, and format of user memory
 
 #define PageSize 	SectorSize 	// set the page size equal to
 					// the disk sector size, for
 					// simplicity
 
-#define NumPhysPages    32
-#define MemorySize 	(NumPhysPages * PageSize)
-#define TLBSize		4		// if there is a TLB, make it small
+// The number of physical pages and the shape of the TLB are chosen when
+// the Machine is created (see the -mem and -tlb flags); these are the
+// defaults.
+#define DefaultPhysPages 32
+#define DefaultTLBSize	4		// if there is a TLB, make it small
+#define MaxPhysPages	(1 << 20)	// 128MB of physical memory
+
+#define CheckpointMagic	0x4e434b33	// "NCK3", at the start of a checkpoint
+					// (with 64-bit statistics)
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -91,6 +106,74 @@ class Instruction {
                      // Immediates are sign-extended.
 };
 
+// The following class defines a basic block -- a run of straight-line
+// instructions, ending with a branch or jump and its delay slot, that
+// the block engine in Machine::Run executes without re-translating
+// the program counter for every instruction.  Blocks never cross a
+// page boundary, so one translation at entry covers the whole block.
+//
+// Blocks are keyed by the physical address of their first instruction
+// and remember the version of their page when they were built; any
+// write to an instruction on that page makes the block stale.
+
+#define MaxBlockLength	(PageSize / 4)	// a block fits within one page
+#define CompileThreshold 50		// runs before a block is compiled
+
+class Machine;
+class CompiledOp;
+
+// A compiled instruction handler: does the work of one instruction,
+// including the delayed load and program counter update, and returns
+// FALSE if the instruction trapped to the kernel.
+typedef bool (*OpHandler)(Machine *machine, CompiledOp *op);
+
+// One instruction of a compiled block.  Register operands have been
+// resolved to pointers into Machine::registers, and the immediate
+// has been extended, so the handler does no decoding at all.
+class CompiledOp {
+  public:
+    OpHandler handler;		// routine that executes the instruction
+    int *rd, *rs, *rt;		// operand registers
+    int imm;			// extended immediate, shift or target
+    Instruction *instr;		// the instruction, for the generic handler
+};
+
+class BasicBlock {
+  public:
+    int physAddr;		// physical address of the first instruction
+    unsigned int version;	// pageVersion of its frame when built
+    int length;			// number of instructions, 0 if none usable
+    Instruction *instrs[MaxBlockLength];	// decoded instructions,
+						// in decodeCache
+    BasicBlock *next[2];	// chained successor blocks, NULL if unknown
+    int runs;			// times executed since it was built
+    CompiledOp *code;		// compiled form, NULL until the block is hot
+};
+
+// A host-side cache of recent translations, so that ReadMem and WriteMem
+// can usually skip Translate altogether.  It is direct mapped by virtual
+// page number, and, like a real TLB, it is not kept coherent with the
+// page table or the TLB: the kernel must call Machine::FlushSoftTLB
+// whenever it switches page tables or changes a translation entry.
+#define SoftTLBSize	16		// must be a power of two
+
+class SoftTLBEntry {
+  public:
+    int virtualPage;		// -1 if this entry is empty
+    char *page;			// host address of the page frame
+    bool writable;		// TRUE if a write has been translated, so the
+				// entry is writable and already marked dirty
+};
+
+// How Machine::Run executes user code.  The interpreter is always the
+// reference; the other modes must give identical results and timing.
+enum ExecMode { InterpretMode,	// one instruction at a time
+		BlockMode,	// the basic block engine
+		CompileMode,	// blocks, with hot blocks compiled
+		CompareMode	// CompileMode, checking every compiled
+				// instruction against the interpreter
+};
+
 // The following class defines the simulated host workstation hardware, as 
 // seen by user programs -- the CPU registers, main memory, etc.
 // User programs shouldn't be able to tell that they are running on our 
@@ -106,8 +189,11 @@ class Instruction {
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
-				// for running user programs
+    Machine(bool debug, ExecMode mode, int physPages, int tlbEntries,
+	    int tlbWays, ReplacePolicy tlbPolicy, bool tlbWalk);
+				// Initialize the simulation of the hardware
+				// for running user programs, with "physPages"
+				// pages of memory and a "tlbEntries" TLB
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
@@ -118,20 +204,95 @@ class Machine {
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
+    bool CopyFromUser(int virtAddr, char *buffer, int size);
+    bool CopyToUser(int virtAddr, char *buffer, int size);
+				// Copy "size" bytes between the current
+				// address space and a kernel buffer, a
+				// page at a time.  Return FALSE if part
+				// of the range isn't mapped
+    bool CopyStringFromUser(int virtAddr, char *buffer, int maxSize);
+				// Copy a null-terminated string of at most
+				// "maxSize" bytes (including the null);
+				// FALSE if unmapped or too long
+
+    void InvalidateDecoded(int physAddr, int size);
+				// Kernel code that writes directly into
+				// mainMemory (program loading, paging)
+				// must call this so stale predecoded
+				// instructions are not executed
+
+    void FlushSoftTLB();	// Forget all cached translations; must be
+				// called after changing the page table
+				// pointer, a page table entry, or the TLB
+
+    void Checkpoint(int fd);	// Save the registers, memory and
+				// statistics to open host file "fd"
+    bool Restore(int fd);	// Load them back; FALSE if "fd" doesn't
+				// hold a checkpoint of this machine
+
+    void FlushTLB(int id);	// Invalidate the TLB entries of address
+				// space "id" (AllSpaces for all of them);
+				// must be called after changing one of its
+				// page table entries, or before reusing "id"
+
 
 // Routines internal to the machine simulation -- DO NOT call these 
 
-    void OneInstruction(Instruction *instr); 	
+    template <bool tracing> void Interpret();
+				// Run a user program one instruction at
+				// a time; never returns.  "tracing" picks
+				// the version with debug output compiled in
+    template <bool tracing> void OneInstruction(Instruction *instr); 	
     				// Run one instruction of a user program.
+    template <bool tracing> bool ExecuteInstruction(Instruction *instr);
+				// Execute an already fetched instruction.
+				// Return FALSE if it raised an exception.
+    void RunBlocks();		// Run a user program with the basic
+				// block engine; never returns
+    BasicBlock *FindBlock(BasicBlock *prev);
+				// Look up (building if needed) the block
+				// starting at the current PC
+    void BuildBlock(BasicBlock *block, int physAddr);
+    bool ExecuteBlock(BasicBlock *block);
+				// Run a block, ticking after each
+				// instruction.  Return FALSE if control
+				// left the block early.
+    void CompileBlock(BasicBlock *block);
+				// Translate a hot block into CompiledOps
+    bool CompareOp(CompiledOp *op);
+				// Run one compiled instruction and check
+				// it against the interpreter
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
     
+    Instruction *FetchDecoded(int physAddr);
+				// Return the decoded form of the instruction
+				// word at "physAddr", decoding it only if it
+				// is not already in the predecoded cache
+
+    void FillSoftTLB(int virtAddr, int physAddr, bool writing);
+				// Remember a translation just made by
+				// Translate
+    TranslationEntry *RefillTLB(TranslationEntry *pte);
+				// Load a page table entry into the TLB
+				// on a miss, as the hardware walker does
+    void Stall(int ticks);	// Advance simulated time while the
+				// processor waits for the memory system
+    void CacheAccess(CacheLevel level, int physAddr, bool writing);
+				// Charge for an access to a level 1 cache
+
     bool ReadMem(int addr, int size, int* value);
     bool WriteMem(int addr, int size, int value);
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
+    template <bool tracing> bool ReadMem(int addr, int size, int* value);
+    template <bool tracing> bool WriteMem(int addr, int size, int value);
+				// The same, with 'a' tracing compiled in
+				// or out; used by the interpreter
     
+    ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
+    template <bool tracing>
     ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
     				// Translate an address, and check for 
 				// alignment.  Set the use and dirty bits in 
@@ -139,6 +300,10 @@ class Machine {
     				// and return an exception code if the 
 				// translation couldn't be completed.
 
+    char *UserPage(int virtAddr, bool writing);
+				// Host address of "virtAddr", for the copy
+				// routines; NULL if it can't be mapped
+
     void RaiseException(ExceptionType which, int badVAddr);
 				// Trap to the Nachos kernel, because of a
 				// system call or other exception.  
@@ -155,7 +320,12 @@ class Machine {
 
     char *mainMemory;		// physical memory to store user program,
 				// code and data, while executing
+    int numPhysPages;		// size of mainMemory, in pages
+    int memorySize;		// size of mainMemory, in bytes
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
+    Cache *cache[NumCacheLevels]; // the caches in front of mainMemory,
+				// NULL for any that are not simulated
+    Profiler *profiler;		// user program profile, NULL if none
 
 
 // NOTE: the hardware translation of virtual addresses in the user program
@@ -169,20 +339,55 @@ class Machine {
 // If "tlb" is non-NULL, the Nachos kernel is responsible for managing
 //	the contents of the TLB.  But the kernel can use any data structure
 //	it wants (eg, segmented paging) for handling TLB cache misses.
+// With the hardware page table walker (-tlbwalk), there is a TLB in
+//	front of the linear page table, and a miss is refilled from
+//	"pageTable" without trapping to the kernel.
+// If "sparseTable" is non-NULL, it is used instead of the linear page
+//	table: a radix or inverted page table (see pagetable.h), in the
+//	format the kernel chose with "pageTableFormat".
+//
+// TLB entries are tagged with "asid", the ID of the address space
+// "pageTable" belongs to, so a context switch needn't flush the TLB.
 // 
 // For simplicity, both the page table pointer and the TLB pointer are
 // public.  However, while there can be multiple page tables (one per address
 // space, stored in memory), there is only one TLB (implemented in hardware).
 // Thus the TLB pointer should be considered as *read-only*, although 
-// the contents of the TLB are free to be modified by the kernel software.
+// the contents of the TLB are free to be modified by the kernel software
+// -- but only for a fully associative TLB with every address space using
+// ASID 0.  Otherwise an entry written directly may sit in the wrong set,
+// or carry the wrong ASID tag, and never be found; use tlbModel->Refill
+// (and FlushTLB) instead (see tlb.h).
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int tlbSize;			// number of entries in the TLB
+    TLB *tlbModel;			// its organization, if there is one
+    bool tlbWalk;			// refill TLB misses from pageTable
+    int asid;				// address space ID for TLB lookups
 
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
 
+    PageTableFormat pageTableFormat;	// the format address spaces use
+    PageTable *sparseTable;		// the current radix or inverted
+					// page table, if not linear
+    InvertedPageTable *invertedTable;	// the one shared inverted page
+					// table, if that is the format
+
   private:
+    Instruction *decodeCache;	// decoded copy of each word of mainMemory
+    bool *decodeValid;		// TRUE if decodeCache[i] matches the word
+				// currently stored at mainMemory[i * 4]
+    unsigned int *pageVersion;	// bumped when an instruction in a
+				// physical page is overwritten
+    BasicBlock **blockMap;	// block starting at each word, if any
+    ExecMode execMode;		// how Run executes user code
+    bool batchTicks;		// advance the clock directly, calling
+				// OneTick only when an interrupt may be due
+    SoftTLBEntry softTLB[SoftTLBSize];	// recent translations, for
+					// ReadMem and WriteMem
+
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
@@ -0,0 +1,262 @@
+// mipscomp.cc -- compile hot basic blocks for the MIPS simulator
+//
+//   Blocks that the basic block engine (see mipssim.cc) runs often
+//   enough are translated into an array of CompiledOps: for each
+//   instruction, a pointer to a routine specialized for its opcode,
+//   with the register operands already resolved to pointers and the
+//   immediate already extended.  Running a compiled block is then a
+//   chain of indirect calls with no decoding and no switch.
+//
+//   Only simple integer and branch instructions get their own routine.
+//   Everything else -- loads, stores, multiply and divide, anything
+//   that can trap -- goes through GenericOp, which simply calls
+//   Machine::ExecuteInstruction, so the interpreter stays the single
+//   definition of the instruction set.  In particular, opcodes where
+//   the interpreter has quirks of its own (OR, SRL, SRLV) are left to
+//   the interpreter, so that compiled code can never disagree with it.
+//
+//   With -jd, every compiled instruction is also checked against the
+//   interpreter (Machine::CompareOp), and we abort on any difference.
+//
+//   The routines are portable C++, rather than native code emitted for
+//   the host, so the compiler works on every host Nachos runs on.  On
+//   an x86-64 host, a tight loop spends only about a fifth of its time
+//   in them; most goes to finding and entering the next block, which a
+//   native emitter wouldn't speed up.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#include "machine.h"
+#include "mipssim.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Finish
+// 	Complete a compiled instruction that did not load from memory:
+//	do any pending delayed load, and advance the program counters,
+//	just as the tail of Machine::ExecuteInstruction does.
+//----------------------------------------------------------------------
+
+static inline bool
+Finish(Machine *m, int pcAfter)
+{
+    m->DelayedLoad(0, 0);
+    m->registers[PrevPCReg] = m->registers[PCReg];
+    m->registers[PCReg] = m->registers[NextPCReg];
+    m->registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+// The next sequential PC, for instructions that don't branch.
+#define Sequential(m)	((m)->registers[NextPCReg] + 4)
+
+// Compute "expr" into the destination register, and move on.
+#define ALU_OP(name, dst, expr)						\
+static bool								\
+name(Machine *m, CompiledOp *op)					\
+{									\
+    *op->dst = (expr);							\
+    return Finish(m, Sequential(m));					\
+}
+
+ALU_OP(AdduOp,  rd, *op->rs + *op->rt)
+ALU_OP(AddiuOp, rt, *op->rs + op->imm)
+ALU_OP(SubuOp,  rd, *op->rs - *op->rt)
+ALU_OP(AndOp,   rd, *op->rs & *op->rt)
+ALU_OP(AndiOp,  rt, *op->rs & op->imm)
+ALU_OP(OriOp,   rt, *op->rs | op->imm)
+ALU_OP(XorOp,   rd, *op->rs ^ *op->rt)
+ALU_OP(XoriOp,  rt, *op->rs ^ op->imm)
+ALU_OP(NorOp,   rd, ~(*op->rs | *op->rt))
+ALU_OP(SllOp,   rd, *op->rt << op->imm)
+ALU_OP(SllvOp,  rd, *op->rt << (*op->rs & 0x1f))
+ALU_OP(SraOp,   rd, *op->rt >> op->imm)
+ALU_OP(SravOp,  rd, *op->rt >> (*op->rs & 0x1f))
+ALU_OP(SltOp,   rd, *op->rs < *op->rt)
+ALU_OP(SltiOp,  rt, *op->rs < op->imm)
+ALU_OP(SltuOp,  rd, (unsigned int) *op->rs < (unsigned int) *op->rt)
+ALU_OP(SltiuOp, rt, (unsigned int) *op->rs < (unsigned int) op->imm)
+ALU_OP(LuiOp,   rt, op->imm)
+ALU_OP(MfhiOp,  rd, m->registers[HiReg])
+ALU_OP(MfloOp,  rd, m->registers[LoReg])
+
+// Branch to NextPC + "imm" if "cond" holds; "imm" is the byte offset.
+#define BRANCH_OP(name, cond)						\
+static bool								\
+name(Machine *m, CompiledOp *op)					\
+{									\
+    if (cond)								\
+	return Finish(m, m->registers[NextPCReg] + op->imm);		\
+    return Finish(m, Sequential(m));					\
+}
+
+BRANCH_OP(BeqOp,  *op->rs == *op->rt)
+BRANCH_OP(BneOp,  *op->rs != *op->rt)
+BRANCH_OP(BlezOp, *op->rs <= 0)
+BRANCH_OP(BgtzOp, *op->rs > 0)
+BRANCH_OP(BltzOp, *op->rs & SIGN_BIT)
+BRANCH_OP(BgezOp, !(*op->rs & SIGN_BIT))
+
+static bool
+JOp(Machine *m, CompiledOp *op)
+{
+    return Finish(m, (Sequential(m) & 0xf0000000) | op->imm);
+}
+
+static bool
+JalOp(Machine *m, CompiledOp *op)
+{
+    m->registers[R31] = Sequential(m);
+    return Finish(m, (Sequential(m) & 0xf0000000) | op->imm);
+}
+
+static bool
+JrOp(Machine *m, CompiledOp *op)
+{
+    return Finish(m, *op->rs);
+}
+
+//----------------------------------------------------------------------
+// GenericOp
+// 	Execute an instruction that has no routine of its own, by handing
+//	it to the interpreter.
+//----------------------------------------------------------------------
+
+static bool
+GenericOp(Machine *m, CompiledOp *op)
+{
+    return m->ExecuteInstruction<FALSE>(op->instr);
+}
+
+//----------------------------------------------------------------------
+// Machine::CompileBlock
+// 	Translate the instructions of "block" into CompiledOps.  The
+//	compiled code lives until the block is rebuilt (see BuildBlock),
+//	which happens whenever the page it came from is overwritten.
+//----------------------------------------------------------------------
+
+void
+Machine::CompileBlock(BasicBlock *block)
+{
+    CompiledOp *code = new CompiledOp[block->length];
+
+    for (int i = 0; i < block->length; i++) {
+	Instruction *instr = block->instrs[i];
+	CompiledOp *op = &code[i];
+
+	op->instr = instr;
+	op->rd = &registers[instr->rd];
+	op->rs = &registers[instr->rs];
+	op->rt = &registers[instr->rt];
+	op->imm = instr->extra;
+	switch (instr->opCode) {
+	  case OP_ADDU:	op->handler = AdduOp; break;
+	  case OP_ADDIU: op->handler = AddiuOp; break;
+	  case OP_SUBU:	op->handler = SubuOp; break;
+	  case OP_AND:	op->handler = AndOp; break;
+	  case OP_XOR:	op->handler = XorOp; break;
+	  case OP_NOR:	op->handler = NorOp; break;
+	  case OP_SLL:	op->handler = SllOp; break;
+	  case OP_SLLV:	op->handler = SllvOp; break;
+	  case OP_SRA:	op->handler = SraOp; break;
+	  case OP_SRAV:	op->handler = SravOp; break;
+	  case OP_SLT:	op->handler = SltOp; break;
+	  case OP_SLTI:	op->handler = SltiOp; break;
+	  case OP_SLTU:	op->handler = SltuOp; break;
+	  case OP_SLTIU: op->handler = SltiuOp; break;
+	  case OP_MFHI:	op->handler = MfhiOp; break;
+	  case OP_MFLO:	op->handler = MfloOp; break;
+	  case OP_JR:	op->handler = JrOp; break;
+
+	  case OP_ANDI:
+	  case OP_ORI:
+	  case OP_XORI:
+	    op->imm = instr->extra & 0xffff;
+	    op->handler = (instr->opCode == OP_ANDI) ? AndiOp :
+			  (instr->opCode == OP_ORI) ? OriOp : XoriOp;
+	    break;
+
+	  case OP_LUI:
+	    op->imm = instr->extra << 16;
+	    op->handler = LuiOp;
+	    break;
+
+	  case OP_BEQ:
+	  case OP_BNE:
+	  case OP_BLEZ:
+	  case OP_BGTZ:
+	  case OP_BLTZ:
+	  case OP_BGEZ:
+	    op->imm = IndexToAddr(instr->extra);
+	    switch (instr->opCode) {
+	      case OP_BEQ:  op->handler = BeqOp; break;
+	      case OP_BNE:  op->handler = BneOp; break;
+	      case OP_BLEZ: op->handler = BlezOp; break;
+	      case OP_BGTZ: op->handler = BgtzOp; break;
+	      case OP_BLTZ: op->handler = BltzOp; break;
+	      default:	    op->handler = BgezOp; break;
+	    }
+	    break;
+
+	  case OP_J:
+	  case OP_JAL:
+	    op->imm = IndexToAddr(instr->extra);
+	    op->handler = (instr->opCode == OP_J) ? JOp : JalOp;
+	    break;
+
+	  default:
+	    op->handler = GenericOp;
+	    break;
+	}
+    }
+    block->code = code;
+    DEBUG('a', "Compiled %d instructions at physical address 0x%x\n",
+	  block->length, block->physAddr);
+}
+
+//----------------------------------------------------------------------
+// Machine::CompareOp
+// 	Run one compiled instruction, and run the same instruction through
+//	the interpreter from the same starting state.  If the two register
+//	files differ afterwards, print both and abort.  The interpreter's
+//	result is the one we keep.
+//
+//	Instructions handled by GenericOp are the interpreter already, and
+//	the ones with routines of their own never touch memory or trap, so
+//	the registers are all the state there is to compare.
+//----------------------------------------------------------------------
+
+bool
+Machine::CompareOp(CompiledOp *op)
+{
+    int before[NumTotalRegs], compiled[NumTotalRegs];
+    int i;
+    bool differ = FALSE;
+
+    if (op->handler == GenericOp)
+	return ExecuteInstruction<FALSE>(op->instr);
+
+    bcopy(registers, before, sizeof(registers));
+    (void) (*op->handler)(this, op);
+    bcopy(registers, compiled, sizeof(registers));
+    bcopy(before, registers, sizeof(registers));
+    (void) ExecuteInstruction<FALSE>(op->instr);
+
+    for (i = 0; i < NumTotalRegs; i++)
+	if (compiled[i] != registers[i]) {
+	    if (!differ)
+		printf("Compiled code differs from the interpreter "
+		       "at PC 0x%x (%s)\n", before[PCReg],
+		       opStrings[op->instr->opCode].string);
+	    printf("\tregister %d: compiled 0x%x, interpreted 0x%x\n",
+		   i, compiled[i], registers[i]);
+	    differ = TRUE;
+	}
+    if (differ)
+	Abort();
+    return TRUE;
+}
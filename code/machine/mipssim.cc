@@ -18,6 +18,92 @@
 
 static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 
+// How to print each instruction, for debugging and profiling, by opCode.
+struct OpString opStrings[] = {
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"ADD r%d,r%d,r%d", {RD, RS, RT}},
+	{"ADDI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"ADDIU r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"ADDU r%d,r%d,r%d", {RD, RS, RT}},
+	{"AND r%d,r%d,r%d", {RD, RS, RT}},
+	{"ANDI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"BEQ r%d,r%d,%d", {RS, RT, EXTRA}},
+	{"BGEZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BGEZAL r%d,%d", {RS, EXTRA, NONE}},
+	{"BGTZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BLEZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BLTZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BLTZAL r%d,%d", {RS, EXTRA, NONE}},
+	{"BNE r%d,r%d,%d", {RS, RT, EXTRA}},
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"DIV r%d,r%d", {RS, RT, NONE}},
+	{"DIVU r%d,r%d", {RS, RT, NONE}},
+	{"J %d", {EXTRA, NONE, NONE}},
+	{"JAL %d", {EXTRA, NONE, NONE}},
+	{"JALR r%d,r%d", {RD, RS, NONE}},
+	{"JR r%d,r%d", {RD, RS, NONE}},
+	{"LB r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LBU r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LH r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LHU r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LUI r%d,%d", {RT, EXTRA, NONE}},
+	{"LW r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LWL r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LWR r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"MFHI r%d", {RD, NONE, NONE}},
+	{"MFLO r%d", {RD, NONE, NONE}},
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"MTHI r%d", {RS, NONE, NONE}},
+	{"MTLO r%d", {RS, NONE, NONE}},
+	{"MULT r%d,r%d", {RS, RT, NONE}},
+	{"MULTU r%d,r%d", {RS, RT, NONE}},
+	{"NOR r%d,r%d,r%d", {RD, RS, RT}},
+	{"OR r%d,r%d,r%d", {RD, RS, RT}},
+	{"ORI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"RFE", {NONE, NONE, NONE}},
+	{"SB r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SH r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SLL r%d,r%d,%d", {RD, RT, EXTRA}},
+	{"SLLV r%d,r%d,r%d", {RD, RT, RS}},
+	{"SLT r%d,r%d,r%d", {RD, RS, RT}},
+	{"SLTI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"SLTIU r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"SLTU r%d,r%d,r%d", {RD, RS, RT}},
+	{"SRA r%d,r%d,%d", {RD, RT, EXTRA}},
+	{"SRAV r%d,r%d,r%d", {RD, RT, RS}},
+	{"SRL r%d,r%d,%d", {RD, RT, EXTRA}},
+	{"SRLV r%d,r%d,r%d", {RD, RT, RS}},
+	{"SUB r%d,r%d,r%d", {RD, RS, RT}},
+	{"SUBU r%d,r%d,r%d", {RD, RS, RT}},
+	{"SW r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SWL r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SWR r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"XOR r%d,r%d,r%d", {RD, RS, RT}},
+	{"XORI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"SYSCALL", {NONE, NONE, NONE}},
+	{"Unimplemented", {NONE, NONE, NONE}},
+	{"Reserved", {NONE, NONE, NONE}}
+      };
+
+//----------------------------------------------------------------------
+// AdvanceUserTime
+// 	Advance simulated time past one user instruction.  Until the
+//	interrupt simulation says some interrupt may be due, all OneTick
+//	would do is bump the clock, so just do that here.  "batching" is
+//	FALSE when interrupt tracing needs to see every tick.
+//----------------------------------------------------------------------
+
+static inline void
+AdvanceUserTime(bool batching)
+{
+    if (batching && (stats->totalTicks + UserTick < interrupt->NextDue())) {
+	stats->totalTicks += UserTick;
+	stats->userTicks += UserTick;
+    } else
+	interrupt->OneTick();
+}
+
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -25,21 +111,67 @@ static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	The interpreter comes in two versions, compiled from the same
+//	templates: one that prints the 'm' and 'a' traces, counts
+//	instructions for the profiler, and can drop into the debugger,
+//	and one where all of that is compiled out.
+//	We pick one here, once, rather than testing the debug flags on
+//	every instruction and memory access.  Only the untraced version
+//	may use the basic block engine, and only without the cache model,
+//	since the block engine doesn't fetch each instruction, and leaves
+//	a block whenever the clock jumps (as it does on a cache miss).
 //----------------------------------------------------------------------
 
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
     if(DebugIsEnabled('m'))
-        printf("Starting thread \"%s\" at time %d\n",
+        printf("Starting thread \"%s\" at time %lld\n",
 	       currentThread->getName(), stats->totalTicks);
     interrupt->setStatus(UserMode);
+    batchTicks = !singleStep && !DebugIsEnabled('i');
+    if (singleStep || DebugIsEnabled('m') || DebugIsEnabled('a') ||
+	    ((profiler != NULL) && profiler->IsCounting()))
+	Interpret<TRUE>();
+    else if ((execMode != InterpretMode) && (cache[L1ICache] == NULL) &&
+	     (cache[L1DCache] == NULL))
+	RunBlocks();
+    else
+	Interpret<FALSE>();
+    ASSERT(FALSE);			// none of the above return
+}
+
+//----------------------------------------------------------------------
+// Machine::Interpret
+// 	Run a user program one instruction at a time; never returns.
+//	"tracing" selects the version of the interpreter (see Run).
+//
+//	Rather than calling OneTick after every instruction, we ask the
+//	interrupt simulation when the next interrupt could be due, and
+//	run instructions in a tight loop, only advancing the clock, until
+//	then.  NextDue is re-read after every instruction, since a trap
+//	into the kernel may schedule an earlier interrupt or switch
+//	threads.  The instruction whose tick reaches the deadline goes
+//	through OneTick, so ticks and preemption points are unchanged.
+//----------------------------------------------------------------------
+
+template <bool tracing>
+void
+Machine::Interpret()
+{
+    Instruction *instr = new Instruction;  // storage for decoded instruction
+
     for (;;) {
-        OneInstruction(instr);
+	if (batchTicks)
+	    while (stats->totalTicks + UserTick < interrupt->NextDue()) {
+		OneInstruction<tracing>(instr);
+		stats->totalTicks += UserTick;
+		stats->userTicks += UserTick;
+	    }
+        OneInstruction<tracing>(instr);
 	interrupt->OneTick();
-	if (singleStep && (runUntilTime <= stats->totalTicks))
+	if (tracing && singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
     }
 }
@@ -81,30 +213,41 @@ TypeToReg(RegType reg, Instruction *instr)
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
-//	We get re-entrancy by never caching any data -- we always re-start the
+//	We get re-entrancy by never caching any data (other than decoded
+//	instructions, which are keyed by physical address and discarded
+//	whenever the memory is written) -- we always re-start the
 //	simulation from scratch each time we are called (or after trapping
 //	back to the Nachos kernel on an exception or interrupt), and we always
 //	store all data back to the machine registers and memory before
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
 //	and the register set.
+//
+//	"tracing" -- if FALSE, the 'm' and 'a' debug output is compiled out
 //----------------------------------------------------------------------
 
+template <bool tracing>
 void
 Machine::OneInstruction(Instruction *instr)
 {
-    int raw;
-    int nextLoadReg = 0; 	
-    int nextLoadValue = 0; 	// record delayed load operation, to apply
-				// in the future
+    int physAddr;
+    ExceptionType exception;
 
-    // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
+    // Fetch instruction.  Only the translation is done on every fetch;
+    // the decoded instruction comes from the predecoded cache.
+    TRACE('a', "Fetching VA 0x%x\n", registers[PCReg]);
+    exception = Translate<tracing>(registers[PCReg], &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
 	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
+    }
+    if (cache[L1ICache] != NULL)
+	CacheAccess(L1ICache, physAddr, FALSE);
+    instr = FetchDecoded(physAddr);
+    if (tracing && (profiler != NULL) && profiler->IsCounting())
+	profiler->Count(registers[PCReg], instr->opCode);
 
-    if (DebugIsEnabled('m')) {
+    if (tracing && DebugIsEnabled('m')) {
        struct OpString *str = &opStrings[instr->opCode];
 
        ASSERT(instr->opCode <= MaxOpcode);
@@ -113,7 +256,30 @@ Machine::OneInstruction(Instruction *instr)
 		TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
        printf("\n");
        }
-    
+
+    (void) ExecuteInstruction<tracing>(instr);
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteInstruction
+// 	Execute one already fetched and decoded instruction, and advance
+//	the program counters.  Shared by OneInstruction and the basic
+//	block engine.
+//
+//	Returns FALSE if the instruction raised an exception (in which
+//	case the kernel has already been entered and has handled it).
+//
+//	"tracing" -- if FALSE, debug output is compiled out
+//----------------------------------------------------------------------
+
+template <bool tracing>
+bool
+Machine::ExecuteInstruction(Instruction *instr)
+{
+    int nextLoadReg = 0; 	
+    int nextLoadValue = 0; 	// record delayed load operation, to apply
+				// in the future
+
     // Compute next pc, but don't install in case there's an error or branch.
     int pcAfter = registers[NextPCReg] + 4;
     int sum, diff, tmp, value;
@@ -127,7 +293,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
 	break;
@@ -137,7 +303,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
 	break;
@@ -231,8 +397,8 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LB:
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
-	if (!machine->ReadMem(tmp, 1, &value))
-	    return;
+	if (!machine->ReadMem<tracing>(tmp, 1, &value))
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -247,10 +413,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
-	if (!machine->ReadMem(tmp, 2, &value))
-	    return;
+	if (!machine->ReadMem<tracing>(tmp, 2, &value))
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -261,7 +427,7 @@ Machine::OneInstruction(Instruction *instr)
 	break;
       	
       case OP_LUI:
-	DEBUG('m', "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
+	TRACE('m', "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
 	registers[instr->rt] = instr->extra << 16;
 	break;
 	
@@ -269,10 +435,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
-	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	if (!machine->ReadMem<tracing>(tmp, 4, &value))
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
 	break;
@@ -285,8 +451,8 @@ Machine::OneInstruction(Instruction *instr)
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	if (!machine->ReadMem<tracing>(tmp, 4, &value))
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -316,8 +482,8 @@ Machine::OneInstruction(Instruction *instr)
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	if (!machine->ReadMem<tracing>(tmp, 4, &value))
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -381,15 +547,15 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_SB:
-	if (!machine->WriteMem((unsigned) 
+	if (!machine->WriteMem<tracing>((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SH:
-	if (!machine->WriteMem((unsigned) 
+	if (!machine->WriteMem<tracing>((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SLL:
@@ -459,7 +625,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
 	break;
@@ -469,9 +635,9 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_SW:
-	if (!machine->WriteMem((unsigned) 
+	if (!machine->WriteMem<tracing>((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SWL:	  
@@ -481,8 +647,8 @@ Machine::OneInstruction(Instruction *instr)
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	if (!machine->ReadMem<tracing>((tmp & ~0x3), 4, &value))
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = registers[instr->rt];
@@ -500,8 +666,8 @@ Machine::OneInstruction(Instruction *instr)
 					    0xff);
 	    break;
 	}
-	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	if (!machine->WriteMem<tracing>((tmp & ~0x3), 4, value))
+	    return FALSE;
 	break;
     	
       case OP_SWR:	  
@@ -511,8 +677,8 @@ Machine::OneInstruction(Instruction *instr)
         // fail (I think) if the other cases are ever exercised.
 	ASSERT((tmp & 0x3) == 0);  
 
-	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	if (!machine->ReadMem<tracing>((tmp & ~0x3), 4, &value))
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = (value & 0xffffff) | (registers[instr->rt] << 24);
@@ -527,13 +693,13 @@ Machine::OneInstruction(Instruction *instr)
 	    value = registers[instr->rt];
 	    break;
 	}
-	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	if (!machine->WriteMem<tracing>((tmp & ~0x3), 4, value))
+	    return FALSE;
 	break;
     	
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE;
 	
       case OP_XOR:
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -546,7 +712,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_RES:
       case OP_UNIMP:
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
       default:
 	ASSERT(FALSE);
@@ -562,6 +728,221 @@ Machine::OneInstruction(Instruction *instr)
 						// are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+// The compiled block handlers (mipscomp.cc) call the untraced version.
+template bool Machine::ExecuteInstruction<FALSE>(Instruction *instr);
+
+//----------------------------------------------------------------------
+// EndsBlock
+// 	Return TRUE if "opCode" transfers control (so the block ends after
+//	its delay slot), and FALSE otherwise.
+//----------------------------------------------------------------------
+
+static bool
+EndsBlock(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ: case OP_BGEZ: case OP_BGEZAL: case OP_BGTZ:
+      case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL: case OP_BNE:
+      case OP_J: case OP_JAL: case OP_JALR: case OP_JR:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// EndsBlockNow
+// 	Return TRUE if "opCode" always traps to the kernel, so there is no
+//	point in putting anything after it in the same block.
+//----------------------------------------------------------------------
+
+static bool
+EndsBlockNow(int opCode)
+{
+    return (opCode == OP_SYSCALL) || (opCode == OP_RES) || 
+	(opCode == OP_UNIMP);
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlocks
+// 	Simulate a user program a basic block at a time.  Each block is
+//	translated once, when it is first reached, into a list of decoded
+//	instructions; after that, only the entry PC is translated, and
+//	blocks are chained directly to the blocks that followed them last
+//	time.  Every instruction still ticks the clock exactly once, just
+//	as in Run (including skipping OneTick until an interrupt may be
+//	due), so simulated time is identical to the interpreter.
+//
+//	Whenever a block can't be used (we are in a delay slot, the PC
+//	doesn't translate, ...), fall back to OneInstruction for a single
+//	step.  Never returns.
+//----------------------------------------------------------------------
+
+void
+Machine::RunBlocks()
+{
+    Instruction *instr = new Instruction;  // storage for OneInstruction
+    BasicBlock *block = NULL;		// the block we just finished
+
+    for (;;) {
+	BasicBlock *next = FindBlock(block);
+
+	if (next == NULL) {
+	    OneInstruction<FALSE>(instr);
+	    AdvanceUserTime(batchTicks);
+	    block = NULL;
+	} else if (ExecuteBlock(next))
+	    block = next;
+	else
+	    block = NULL;		// left early; don't chain from it
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::FindBlock
+// 	Return the basic block starting at the current PC, building it if
+//	this is the first time we have been here (or the code changed).
+//	Returns NULL if the next instruction should be interpreted instead.
+//
+//	"prev" -- the block that just ran to completion, or NULL; its
+//		successor links are tried before the block map.
+//----------------------------------------------------------------------
+
+BasicBlock *
+Machine::FindBlock(BasicBlock *prev)
+{
+    int pc = registers[PCReg];
+    int physAddr, i;
+    BasicBlock *block;
+
+    if (registers[NextPCReg] != pc + 4)	// in a delay slot
+	return NULL;
+    if (Translate<FALSE>(pc, &physAddr, 4, FALSE) != NoException)
+	return NULL;			// let OneInstruction raise it
+
+    if (prev != NULL)
+	for (i = 0; i < 2; i++) {
+	    block = prev->next[i];
+	    if ((block != NULL) && (block->physAddr == physAddr) &&
+		    (block->version == pageVersion[physAddr / PageSize]))
+		return block;		// chained
+	}
+
+    block = blockMap[physAddr / 4];
+    if (block == NULL) {
+	block = new BasicBlock;
+	block->physAddr = -1;
+	block->code = NULL;
+	blockMap[physAddr / 4] = block;
+    }
+    if ((block->physAddr != physAddr) ||
+	    (block->version != pageVersion[physAddr / PageSize]))
+	BuildBlock(block, physAddr);
+    if (block->length == 0)
+	return NULL;
+
+    if (prev != NULL) {			// remember block as a successor
+	if (prev->next[0] == NULL)
+	    prev->next[0] = block;
+	else
+	    prev->next[1] = block;
+    }
+    return block;
+}
+
+//----------------------------------------------------------------------
+// Machine::BuildBlock
+// 	Decode the straight-line run of instructions starting at physical
+//	address "physAddr" into "block".  The block ends after the delay
+//	slot of the first branch or jump, at an instruction that always
+//	traps, or at the end of the page.  A branch whose delay slot is on
+//	the next page is left out, so that OneInstruction handles it.
+//----------------------------------------------------------------------
+
+void
+Machine::BuildBlock(BasicBlock *block, int physAddr)
+{
+    int pageEnd = (physAddr / PageSize + 1) * PageSize;
+    int addr = physAddr;
+    Instruction *instr;
+
+    block->physAddr = physAddr;
+    block->version = pageVersion[physAddr / PageSize];
+    block->length = 0;
+    block->next[0] = block->next[1] = NULL;
+    block->runs = 0;
+    if (block->code != NULL) {		// compiled from the old contents
+	delete [] block->code;
+	block->code = NULL;
+    }
+
+    while (addr < pageEnd) {
+	instr = FetchDecoded(addr);
+	if (EndsBlock(instr->opCode)) {
+	    if (addr + 4 >= pageEnd)
+		break;			// delay slot on another page
+	    block->instrs[block->length++] = instr;
+	    block->instrs[block->length++] = FetchDecoded(addr + 4);
+	    break;
+	}
+	block->instrs[block->length++] = instr;
+	if (EndsBlockNow(instr->opCode))
+	    break;
+	addr += 4;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteBlock
+// 	Run the instructions of "block", advancing simulated time after
+//	each one exactly as Run does.  Stop early if an instruction traps,
+//	if the kernel ran while the clock ticked (an interrupt handler or
+//	a context switch may have changed the translation or the TLB),
+//	or if the block's code was overwritten.
+//
+//	In CompileMode, a block that has run CompileThreshold times is
+//	compiled (see mipscomp.cc), and from then on its CompiledOps are
+//	run instead of ExecuteInstruction.
+//
+//	Returns TRUE if the whole block ran, FALSE if we left early.
+//----------------------------------------------------------------------
+
+bool
+Machine::ExecuteBlock(BasicBlock *block)
+{
+    int entryPC = registers[PCReg];
+    int frame = block->physAddr / PageSize;
+    CompiledOp *code = block->code;
+    long long ticks;
+    bool ok;
+
+    if ((code == NULL) && (execMode != BlockMode) &&
+	    (++block->runs >= CompileThreshold)) {
+	CompileBlock(block);
+	code = block->code;
+    }
+    for (int i = 0; i < block->length; i++) {
+	ticks = stats->totalTicks;
+	if (code == NULL)
+	    ok = ExecuteInstruction<FALSE>(block->instrs[i]);
+	else if (execMode == CompareMode)
+	    ok = CompareOp(&code[i]);
+	else
+	    ok = (*code[i].handler)(this, &code[i]);
+	AdvanceUserTime(batchTicks);
+	if (!ok)
+	    return FALSE;
+	if ((stats->totalTicks != ticks + UserTick) ||
+		(block->version != pageVersion[frame]))
+	    return FALSE;
+	if ((i < block->length - 1) &&
+		(registers[PCReg] != entryPC + (i + 1) * 4))
+	    return FALSE;
+    }
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -581,6 +962,71 @@ Machine::DelayedLoad(int nextReg, int nextValue)
     registers[0] = 0; 	// and always make sure R0 stays zero.
 }
 
+//----------------------------------------------------------------------
+// Machine::FetchDecoded
+// 	Return the decoded instruction stored at physical address
+//	"physAddr".  Tight loops execute the same words over and over,
+//	so each word is decoded once and kept in "decodeCache" until
+//	InvalidateDecoded says the underlying memory has changed.
+//
+//	"physAddr" -- word-aligned offset into mainMemory
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchDecoded(int physAddr)
+{
+    int word = physAddr / 4;
+    Instruction *instr = &decodeCache[word];
+
+    if (!decodeValid[word]) {
+	instr->value = WordToHost(*(unsigned int *) &mainMemory[physAddr]);
+	instr->Decode();
+	decodeValid[word] = TRUE;
+    }
+    return instr;
+}
+
+/*
+ * The table below is used to translate bits 31:26 of the instruction
+ * into a value suitable for the "opCode" field of a MemWord structure,
+ * or into a special value for further decoding.
+ */
+
+static OpInfo opTable[] = {
+    {SPECIAL, RFMT}, {BCOND, IFMT}, {OP_J, JFMT}, {OP_JAL, JFMT},
+    {OP_BEQ, IFMT}, {OP_BNE, IFMT}, {OP_BLEZ, IFMT}, {OP_BGTZ, IFMT},
+    {OP_ADDI, IFMT}, {OP_ADDIU, IFMT}, {OP_SLTI, IFMT}, {OP_SLTIU, IFMT},
+    {OP_ANDI, IFMT}, {OP_ORI, IFMT}, {OP_XORI, IFMT}, {OP_LUI, IFMT},
+    {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT},
+    {OP_LB, IFMT}, {OP_LH, IFMT}, {OP_LWL, IFMT}, {OP_LW, IFMT},
+    {OP_LBU, IFMT}, {OP_LHU, IFMT}, {OP_LWR, IFMT}, {OP_RES, IFMT},
+    {OP_SB, IFMT}, {OP_SH, IFMT}, {OP_SWL, IFMT}, {OP_SW, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_SWR, IFMT}, {OP_RES, IFMT},
+    {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT},
+    {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}
+};
+
+/*
+ * The table below is used to convert the "funct" field of SPECIAL
+ * instructions into the "opCode" field of a MemWord.
+ */
+
+static int specialTable[] = {
+    OP_SLL, OP_RES, OP_SRL, OP_SRA, OP_SLLV, OP_RES, OP_SRLV, OP_SRAV,
+    OP_JR, OP_JALR, OP_RES, OP_RES, OP_SYSCALL, OP_UNIMP, OP_RES, OP_RES,
+    OP_MFHI, OP_MTHI, OP_MFLO, OP_MTLO, OP_RES, OP_RES, OP_RES, OP_RES,
+    OP_MULT, OP_MULTU, OP_DIV, OP_DIVU, OP_RES, OP_RES, OP_RES, OP_RES,
+    OP_ADD, OP_ADDU, OP_SUB, OP_SUBU, OP_AND, OP_OR, OP_XOR, OP_NOR,
+    OP_RES, OP_RES, OP_SLT, OP_SLTU, OP_RES, OP_RES, OP_RES, OP_RES,
+    OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES,
+    OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES
+};
+
 //----------------------------------------------------------------------
 // Instruction::Decode
 // 	Decode a MIPS instruction 
@@ -23,6 +23,8 @@ static void NetworkReadPoll(_int arg)
 { Network *net = (Network *)arg; net->CheckPktAvail(); }
 static void NetworkSendDone(_int arg)
 { Network *net = (Network *)arg; net->SendDone(); }
+static void NetworkReceiveReady(_int arg)
+{ Network *net = (Network *)arg; net->ReceiveReady(); }
 
 // Initialize the network emulation
 //   addr is used to generate the socket name
@@ -53,29 +55,50 @@ Network::Network(NetworkAddress addr, double reliability, double orderability,
     AssignNameToSocket(sockName, sock);		 // Bind socket to a filename 
 						 // in the current directory.
 
-    // start polling for incoming packets
-    interrupt->Schedule(NetworkReadPoll, (_int)this, NetworkTime, NetworkRecvInt);
+    // start looking for incoming packets
+    ArmReceive();
 }
 
 Network::~Network()
 {
+    interrupt->Cancel(readPoll);
+    UnwatchFile(sock);
     CloseSocket(sock);
     DeAssignNameToSocket(sockName);
 }
 
+// get ready for the next packet: poll for it in NetworkTime ticks,
+// or, unless devices are to poll, have the host tell us when it comes
+void
+Network::ArmReceive()
+{
+    if (interrupt->PolledIO())
+	readPoll = interrupt->Schedule(NetworkReadPoll, (_int)this,
+				       NetworkTime, NetworkRecvInt);
+    else
+	WatchFile(sock, NetworkReceiveReady, (_int)this);
+}
+
+// the host has a packet for us; it arrives NetworkTime ticks later
+void
+Network::ReceiveReady()
+{
+    UnwatchFile(sock);
+    readPoll = interrupt->Schedule(NetworkReadPoll, (_int)this, NetworkTime,
+				   NetworkRecvInt);
+}
+
 // if a packet is already buffered, we simply delay reading 
-// the incoming packet.  In real life, the incoming 
+// the incoming packet (we stop polling until Receive takes the 
+// buffered one).  In real life, the incoming 
 // packet might be dropped if we can't read it in time.
 void
 Network::CheckPktAvail()
 {
-    // schedule the next time to poll for a packet
-    interrupt->Schedule(NetworkReadPoll, (_int)this, NetworkTime, NetworkRecvInt);
-
-    if (inHdr.length != 0) 	// do nothing if packet is already buffered
-	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
+    if (!PollSocket(sock)) {	// no packet to be read; look again
+	ArmReceive();
 	return;
+    }
 
     // otherwise, read packet in
     char *buffer = new char[MaxWireSize];
@@ -90,6 +113,7 @@ Network::CheckPktAvail()
     DEBUG('n', "Network received packet from %d, length %d...\n",
 	  				(int) inHdr.from, inHdr.length);
     stats->numPacketsRecvd++;
+    inTime = stats->totalTicks;
 
     // tell post office that the packet has arrived
     (*readHandler)(handlerArg);	
@@ -101,6 +125,7 @@ Network::SendDone()
 {
     sendBusy = FALSE;
     stats->numPacketsSent++;
+    stats->latency[NetSendLatency].Record(stats->totalTicks - sendTime);
     (*writeHandler)(handlerArg);
 }
 
@@ -118,6 +143,7 @@ Network::Send(PacketHeader hdr, char* data)
 		&& (hdr.length <= MaxPacketSize) && (hdr.from == ident));
     DEBUG('n', "Sending to addr %d, %d bytes... ", hdr.to, hdr.length);
 
+    sendTime = stats->totalTicks;
     interrupt->Schedule(NetworkSendDone, (_int)this, NetworkTime, NetworkSendInt);
 
     if (Random() % 100 >= chanceToWork * 100) { // emulate a lost packet
@@ -156,7 +182,11 @@ Network::Receive(char* data)
     PacketHeader hdr = inHdr;
 
     inHdr.length = 0;
-    if (hdr.length != 0)
+    if (hdr.length != 0) {
     	bcopy(inbox, data, hdr.length);
+	stats->latency[NetRecvLatency].Record(stats->totalTicks - inTime);
+    }
+    if (!interrupt->IsPending(readPoll))	// room again; resume polling
+	ArmReceive();
     return hdr;
 }
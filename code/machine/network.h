@@ -25,6 +25,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "interrupt.h"
 
 // Network address -- uniquely identifies a machine.  This machine's ID 
 //  is given on the command line.
@@ -105,8 +106,11 @@ class Network {
     void SendDone();		// Interrupt handler, called when message is 
 				// sent
     void CheckPktAvail();	// Check if there is an incoming packet
+    void ReceiveReady();	// Called when the host says there is one
 
   private:
+    void ArmReceive();		// Get ready for the next packet
+
     NetworkAddress ident;	// This machine's network address
     double chanceToWork;	// Likelihood packet will not be dropped
     double chanceToNotDelay;       // Likelihood packet will not be delayed
@@ -126,6 +130,10 @@ class Network {
     char delayBuf[MaxWireSize];  // Place to save a delayed packet
     char delayToName[32];       // Place to send delayed packet, eventually
     bool delayBufFull;          // Is delayBuf in use?
+    IntHandle readPoll;		// The next poll for a packet; not pending
+				// while one is buffered
+    long long sendTime;		// When the packet being sent was sent
+    long long inTime;		// When the packet in "inbox" arrived
 };
 
 #endif // NETWORK_H
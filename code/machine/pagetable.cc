@@ -0,0 +1,254 @@
+// pagetable.cc
+//	Routines to manage the radix and inverted page table formats.
+//	See pagetable.h for details.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pagetable.h"
+
+//----------------------------------------------------------------------
+// InvertedPageTable::InvertedPageTable
+// 	Initialize an inverted page table for "frames" physical page
+//	frames, all of them free.  There is one hash chain per frame, so
+//	chains are short.
+//----------------------------------------------------------------------
+
+InvertedPageTable::InvertedPageTable(int frames)
+{
+    numFrames = frames;
+    entries = new TranslationEntry[numFrames];
+    owners = new int[numFrames];
+    chains = new int[numFrames];
+    buckets = new int[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+	entries[i].valid = FALSE;
+	owners[i] = -1;
+	chains[i] = -1;
+	buckets[i] = -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::~InvertedPageTable
+// 	De-allocate the table.
+//----------------------------------------------------------------------
+
+InvertedPageTable::~InvertedPageTable()
+{
+    delete [] entries;
+    delete [] owners;
+    delete [] chains;
+    delete [] buckets;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Hash
+// 	Return the hash chain for virtual page "vpn" of address space
+//	"asid".  Multiplying by a large odd constant spreads consecutive
+//	pages, and the same page of different spaces, across the chains.
+//----------------------------------------------------------------------
+
+int
+InvertedPageTable::Hash(int asid, unsigned int vpn)
+{
+    return ((vpn + (unsigned int) asid * 4099) * 2654435761U) % numFrames;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Lookup
+// 	Search the hash chain of "vpn" for the frame holding it on
+//	behalf of address space "asid".  Returns the frame's entry, or
+//	NULL if the page isn't mapped.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+InvertedPageTable::Lookup(int asid, unsigned int vpn)
+{
+    for (int frame = buckets[Hash(asid, vpn)]; frame != -1;
+	     frame = chains[frame])
+	if ((owners[frame] == asid) &&
+		((unsigned int) entries[frame].virtualPage == vpn))
+	    return &entries[frame];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Insert
+// 	Record that physical page "frame" holds virtual page "vpn" of
+//	address space "asid", and put it on its hash chain.  The caller
+//	sets the protection bits in the entry returned.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+InvertedPageTable::Insert(int asid, unsigned int vpn, int frame)
+{
+    int bucket = Hash(asid, vpn);
+
+    ASSERT((frame >= 0) && (frame < numFrames) && (owners[frame] == -1));
+    entries[frame].virtualPage = vpn;
+    entries[frame].physicalPage = frame;
+    entries[frame].valid = TRUE;
+    entries[frame].use = FALSE;
+    entries[frame].dirty = FALSE;
+    entries[frame].readOnly = FALSE;
+    owners[frame] = asid;
+    chains[frame] = buckets[bucket];
+    buckets[bucket] = frame;
+    return &entries[frame];
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Remove
+// 	Free every frame belonging to address space "asid", unlinking
+//	each from its hash chain.
+//----------------------------------------------------------------------
+
+void
+InvertedPageTable::Remove(int asid)
+{
+    for (int frame = 0; frame < numFrames; frame++) {
+	if (owners[frame] != asid)
+	    continue;
+
+	int *link = &buckets[Hash(asid, entries[frame].virtualPage)];
+
+	while (*link != frame)
+	    link = &chains[*link];
+	*link = chains[frame];
+	chains[frame] = -1;
+	owners[frame] = -1;
+	entries[frame].valid = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Footprint
+// 	Return the bytes of host memory the whole table takes.
+//----------------------------------------------------------------------
+
+int
+InvertedPageTable::Footprint()
+{
+    return numFrames * (sizeof(TranslationEntry) + 3 * sizeof(int));
+}
+
+//----------------------------------------------------------------------
+// PageTable::PageTable
+// 	Initialize an empty page table for address space "spaceId".
+//
+//	"tableFormat" -- RadixTable or InvertedTable
+//	"shared" -- for InvertedTable, the table shared by all address
+//		spaces
+//----------------------------------------------------------------------
+
+PageTable::PageTable(PageTableFormat tableFormat, int spaceId,
+		     InvertedPageTable *shared)
+{
+    ASSERT((tableFormat == RadixTable) ||
+	   ((tableFormat == InvertedTable) && (shared != NULL)));
+    format = tableFormat;
+    asid = spaceId;
+    directory = NULL;
+    numLeaves = 0;
+    numMapped = 0;
+    inverted = shared;
+    if (format == RadixTable) {
+	directory = new TranslationEntry *[RadixTopSize];
+	for (int i = 0; i < RadixTopSize; i++)
+	    directory[i] = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// PageTable::~PageTable
+// 	De-allocate a radix table, or free the frames an inverted table
+//	holds for this address space.
+//----------------------------------------------------------------------
+
+PageTable::~PageTable()
+{
+    if (format == RadixTable) {
+	for (int i = 0; i < RadixTopSize; i++)
+	    if (directory[i] != NULL)
+		delete [] directory[i];
+	delete [] directory;
+    } else
+	inverted->Remove(asid);
+}
+
+//----------------------------------------------------------------------
+// PageTable::Lookup
+// 	Return the entry mapping virtual page "vpn", or NULL if there is
+//	no valid one.  For a radix table, that is two array references.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+PageTable::Lookup(unsigned int vpn)
+{
+    TranslationEntry *leaf;
+
+    if (format == InvertedTable)
+	return inverted->Lookup(asid, vpn);
+    if (vpn >= (unsigned int) MaxVirtPages)
+	return NULL;
+    leaf = directory[vpn >> RadixLeafBits];
+    if ((leaf == NULL) || !leaf[vpn & (RadixLeafSize - 1)].valid)
+	return NULL;
+    return &leaf[vpn & (RadixLeafSize - 1)];
+}
+
+//----------------------------------------------------------------------
+// PageTable::Map
+// 	Map virtual page "vpn" to physical page "frame", allocating the
+//	second-level table for it if need be.  The entry returned is
+//	valid, and writable; the caller may change that.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+PageTable::Map(unsigned int vpn, int frame)
+{
+    TranslationEntry *entry;
+
+    ASSERT((vpn < (unsigned int) MaxVirtPages) && (Lookup(vpn) == NULL));
+    numMapped++;
+    if (format == InvertedTable)
+	return inverted->Insert(asid, vpn, frame);
+
+    if (directory[vpn >> RadixLeafBits] == NULL) {
+	TranslationEntry *leaf = new TranslationEntry[RadixLeafSize];
+
+	for (int i = 0; i < RadixLeafSize; i++)
+	    leaf[i].valid = FALSE;
+	directory[vpn >> RadixLeafBits] = leaf;
+	numLeaves++;
+    }
+    entry = &directory[vpn >> RadixLeafBits][vpn & (RadixLeafSize - 1)];
+    entry->virtualPage = vpn;
+    entry->physicalPage = frame;
+    entry->valid = TRUE;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    entry->readOnly = FALSE;
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// PageTable::Footprint
+// 	Return the bytes of host memory this address space's page table
+//	takes: the directory and second-level tables of a radix table,
+//	or this space's share of the entries of the inverted table.
+//----------------------------------------------------------------------
+
+int
+PageTable::Footprint()
+{
+    if (format == InvertedTable)
+	return numMapped * (sizeof(TranslationEntry) + 3 * sizeof(int));
+    return RadixTopSize * sizeof(TranslationEntry *) +
+	numLeaves * RadixLeafSize * sizeof(TranslationEntry);
+}
@@ -0,0 +1,112 @@
+// pagetable.h
+//	Data structures for the page table formats that, unlike the
+//	linear page table, don't need an entry for every virtual page
+//	below the highest one used, so that an address space can be
+//	large and sparse -- a stack at the top of a 2GB address space,
+//	say, with a huge hole below it -- without a huge page table.
+//
+//	A radix page table is a two-level tree: the top bits of the
+//	virtual page number index a directory of second-level tables,
+//	which are only allocated for the parts of the address space
+//	that are used.
+//
+//	An inverted page table has one entry per physical page frame,
+//	shared by all address spaces; each entry is tagged with the
+//	address space ID of the page it holds, and a lookup hashes the
+//	(address space, virtual page) pair to find it.  Its size depends
+//	only on the size of physical memory.
+//
+//	The linear format is still just an array of TranslationEntry's
+//	(Machine::pageTable).  Which format user programs get is chosen
+//	with the -pt flag.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGETABLE_H
+#define PAGETABLE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "translate.h"
+
+// The page table formats the simulated MMU understands.
+enum PageTableFormat { LinearTable, RadixTable, InvertedTable };
+
+#define RadixLeafBits	12	// virtual page # bits per second-level table
+#define RadixTopBits	12	// virtual page # bits indexing the directory
+#define RadixLeafSize	(1 << RadixLeafBits)
+#define RadixTopSize	(1 << RadixTopBits)
+#define MaxVirtPages	(RadixTopSize * RadixLeafSize)
+				// pages in a sparse address space: 2GB,
+				// with 128 byte pages
+
+// The following class defines the inverted page table, with one
+// entry per physical page frame.
+
+class InvertedPageTable {
+  public:
+    InvertedPageTable(int frames);
+				// Initialize a table in which every
+				// frame is free
+    ~InvertedPageTable();	// De-allocate it
+
+    TranslationEntry *Lookup(int asid, unsigned int vpn);
+				// The entry mapping "vpn" of address
+				// space "asid", or NULL if there is none
+    TranslationEntry *Insert(int asid, unsigned int vpn, int frame);
+				// Map "vpn" of "asid" to "frame", which
+				// must be free; return its entry
+    void Remove(int asid);	// Free every frame of address space "asid"
+
+    int Footprint();		// Bytes of host memory the table uses
+
+  private:
+    int Hash(int asid, unsigned int vpn);
+				// Which hash chain "vpn" of "asid" is on
+
+    int numFrames;		// number of entries, and of hash chains
+    TranslationEntry *entries;	// the page held by each frame
+    int *owners;		// address space of each frame, -1 if free
+    int *chains;		// next frame on the same hash chain, or -1
+    int *buckets;		// first frame on each hash chain, or -1
+};
+
+// The following class defines the page table of one address space,
+// in either the radix or the inverted format.
+
+class PageTable {
+  public:
+    PageTable(PageTableFormat tableFormat, int spaceId,
+	      InvertedPageTable *shared);
+				// Initialize an empty page table for
+				// address space "spaceId"; an inverted table
+				// adds its entries to "shared"
+    ~PageTable();		// Remove all its mappings
+
+    TranslationEntry *Lookup(unsigned int vpn);
+				// The valid entry mapping "vpn", or NULL
+    TranslationEntry *Map(unsigned int vpn, int frame);
+				// Map "vpn" to physical page "frame";
+				// return the new entry, for the kernel
+				// to set the other bits in
+
+    int Footprint();		// Bytes of host memory this address
+				// space's table uses (for an inverted
+				// table, its share of the entries)
+    PageTableFormat Format() { return format; }
+
+  private:
+    PageTableFormat format;	// RadixTable or InvertedTable
+    int asid;			// the address space the table belongs to
+    TranslationEntry **directory; // RadixTable: second-level tables, NULL
+				// where no page of that range is mapped
+    int numLeaves;		// RadixTable: second-level tables allocated
+    int numMapped;		// pages mapped
+    InvertedPageTable *inverted; // InvertedTable: where the entries are
+};
+
+#endif // PAGETABLE_H
@@ -0,0 +1,300 @@
+// profile.cc
+//	Routines to profile user programs: exact per-PC and per-opcode
+//	counts, timer-driven PC samples, and the report of where the
+//	time went.  See profile.h for details.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "profile.h"
+#include "machine.h"
+#include "mipssim.h"
+
+//----------------------------------------------------------------------
+// Profiler::Profiler
+// 	Initialize empty counters.
+//
+//	"count" -- if TRUE, count every instruction executed
+//	"sample" -- if TRUE, record the PC at each timer interrupt
+//----------------------------------------------------------------------
+
+Profiler::Profiler(bool count, bool sample)
+{
+    ASSERT(MaxOpcode + 1 == ProfileOpcodes);
+    counting = count;
+    sampling = sample;
+    counts = samples = NULL;
+    numWords = 0;
+    for (int i = 0; i < ProfileOpcodes; i++)
+	opCounts[i] = 0;
+    numSamples = 0;
+    symbols = NULL;
+    numSymbols = 0;
+}
+
+//----------------------------------------------------------------------
+// Profiler::~Profiler
+// 	De-allocate the counters and the symbol table.
+//----------------------------------------------------------------------
+
+Profiler::~Profiler()
+{
+    delete [] counts;
+    delete [] samples;
+    for (int i = 0; i < numSymbols; i++)
+	delete [] symbols[i].name;
+    delete [] symbols;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Grow
+// 	Enlarge the per-PC counters to cover "pc", at least doubling them
+//	so that a program's address space is covered after a few tries.
+//----------------------------------------------------------------------
+
+void
+Profiler::Grow(int pc)
+{
+    int size = (numWords > 0) ? numWords : 1024;
+    unsigned int *newCounts, *newSamples;
+
+    while ((unsigned) pc / 4 >= (unsigned) size)
+	size *= 2;
+    newCounts = new unsigned int[size];
+    newSamples = new unsigned int[size];
+    bzero(newCounts, size * sizeof(unsigned int));
+    bzero(newSamples, size * sizeof(unsigned int));
+    if (numWords > 0) {
+	bcopy(counts, newCounts, numWords * sizeof(unsigned int));
+	bcopy(samples, newSamples, numWords * sizeof(unsigned int));
+	delete [] counts;
+	delete [] samples;
+    }
+    counts = newCounts;
+    samples = newSamples;
+    numWords = size;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Sample
+// 	Record that the timer interrupted user code at "pc".
+//----------------------------------------------------------------------
+
+void
+Profiler::Sample(int pc)
+{
+    if ((unsigned) pc / 4 >= (unsigned) numWords)
+	Grow(pc);
+    samples[pc / 4]++;
+    numSamples++;
+}
+
+//----------------------------------------------------------------------
+// Profiler::LoadSymbols
+// 	Read the text symbols from "fileName", which holds the output of
+//	"nm -n" for the program being profiled: one "address type name"
+//	line per symbol, in order of address.  If the file can't be read,
+//	the report just gives addresses.
+//----------------------------------------------------------------------
+
+void
+Profiler::LoadSymbols(char *fileName)
+{
+    FILE *file = fopen(fileName, "r");
+    char line[256], name[256], type;
+    unsigned int address;
+    int max = 64;
+
+    if (file == NULL) {
+	printf("Profiler: can't open symbol file %s\n", fileName);
+	return;
+    }
+    symbols = new ProfileSymbol[max];
+    while (fgets(line, sizeof(line), file) != NULL) {
+	if ((sscanf(line, "%x %c %255s", &address, &type, name) != 3) ||
+		((type != 'T') && (type != 't')))
+	    continue;			// not a function
+	if (numSymbols == max) {
+	    ProfileSymbol *bigger = new ProfileSymbol[max * 2];
+
+	    bcopy(symbols, bigger, max * sizeof(ProfileSymbol));
+	    delete [] symbols;
+	    symbols = bigger;
+	    max *= 2;
+	}
+	symbols[numSymbols].address = address;
+	symbols[numSymbols].name = new char[strlen(name) + 1];
+	strcpy(symbols[numSymbols].name, name);
+	numSymbols++;
+    }
+    fclose(file);
+}
+
+//----------------------------------------------------------------------
+// Profiler::FindSymbol
+// 	Return the function containing "address" -- the last symbol at or
+//	before it -- or NULL if there is none.
+//----------------------------------------------------------------------
+
+ProfileSymbol *
+Profiler::FindSymbol(unsigned int address)
+{
+    int low = 0, high = numSymbols - 1, mid;
+    ProfileSymbol *found = NULL;
+
+    while (low <= high) {		// binary search
+	mid = (low + high) / 2;
+	if (symbols[mid].address <= address) {
+	    found = &symbols[mid];
+	    low = mid + 1;
+	} else
+	    high = mid - 1;
+    }
+    return found;
+}
+
+// An index into a histogram, and its count, for sorting in Report.
+struct ProfileEntry {
+    int index;
+    unsigned int count;
+};
+
+//----------------------------------------------------------------------
+// SelectTop
+// 	Move the "k" largest of the "n" entries to the front, largest
+//	first.  The report only ever prints the top few entries, so a
+//	selection sort over them is all we need.
+//----------------------------------------------------------------------
+
+static void
+SelectTop(ProfileEntry *entries, int n, int k)
+{
+    ProfileEntry tmp;
+
+    for (int i = 0; (i < k) && (i < n); i++) {
+	int max = i;
+
+	for (int j = i + 1; j < n; j++)
+	    if (entries[j].count > entries[max].count)
+		max = j;
+	tmp = entries[i];
+	entries[i] = entries[max];
+	entries[max] = tmp;
+    }
+}
+
+// Return "count" as a percentage of "total".
+static double
+Percent(unsigned int count, unsigned int total)
+{
+    return (total == 0) ? 0.0 : (100.0 * count) / total;
+}
+
+// Print the part of opcode name "string" up to its operands.
+static void
+PrintOpName(char *string)
+{
+    int length = strcspn(string, " ");
+
+    printf("%-8.*s", length, string);
+}
+
+//----------------------------------------------------------------------
+// Profiler::ReportHistogram
+// 	Print the ProfileTopN most frequent PCs in "hist" (either the
+//	exact counts or the samples), then, if we have symbols, the
+//	ProfileTopN functions with the highest totals.
+//----------------------------------------------------------------------
+
+void
+Profiler::ReportHistogram(const char *what, unsigned int *hist)
+{
+    ProfileEntry *entries = new ProfileEntry[numWords];
+    unsigned int total = 0;
+    int n = 0, i;
+
+    for (i = 0; i < numWords; i++)
+	if (hist[i] > 0) {
+	    entries[n].index = i;
+	    entries[n].count = hist[i];
+	    total += hist[i];
+	    n++;
+	}
+    SelectTop(entries, n, ProfileTopN);
+    printf("Hot spots, by %s:\n", what);
+    for (i = 0; (i < n) && (i < ProfileTopN); i++) {
+	unsigned int pc = entries[i].index * 4;
+	ProfileSymbol *sym = FindSymbol(pc);
+
+	printf("  0x%08x %10u %6.2f%%", pc, entries[i].count,
+	       Percent(entries[i].count, total));
+	if (sym != NULL)
+	    printf("  %s+0x%x", sym->name, pc - sym->address);
+	printf("\n");
+    }
+
+    if (numSymbols > 0) {		// fold the PCs into functions
+	ProfileEntry *funcs = new ProfileEntry[numSymbols + 1];
+
+	for (i = 0; i <= numSymbols; i++) {
+	    funcs[i].index = i;		// numSymbols is "unknown"
+	    funcs[i].count = 0;
+	}
+	for (i = 0; i < n; i++) {
+	    ProfileSymbol *sym = FindSymbol(entries[i].index * 4);
+
+	    funcs[(sym == NULL) ? numSymbols : sym - symbols].count +=
+		entries[i].count;
+	}
+	SelectTop(funcs, numSymbols + 1, ProfileTopN);
+	printf("Hot functions, by %s:\n", what);
+	for (i = 0; (i <= numSymbols) && (i < ProfileTopN) &&
+		 (funcs[i].count > 0); i++)
+	    printf("  %-24s %10u %6.2f%%\n", (funcs[i].index == numSymbols) ?
+		   "(unknown)" : symbols[funcs[i].index].name,
+		   funcs[i].count, Percent(funcs[i].count, total));
+	delete [] funcs;
+    }
+    delete [] entries;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Report
+// 	Print the profile: the opcode histogram and the hot spots from
+//	the exact counts, if we kept them, and from the samples, if we
+//	took them.
+//----------------------------------------------------------------------
+
+void
+Profiler::Report()
+{
+    unsigned int total = 0;
+    ProfileEntry ops[ProfileOpcodes];
+    int i;
+
+    if (counting) {
+	for (i = 0; i < ProfileOpcodes; i++) {
+	    ops[i].index = i;
+	    ops[i].count = opCounts[i];
+	    total += opCounts[i];
+	}
+	SelectTop(ops, ProfileOpcodes, ProfileOpcodes);
+	printf("\nProfile: %u user instructions\n", total);
+	printf("Opcodes:\n");
+	for (i = 0; (i < ProfileOpcodes) && (ops[i].count > 0); i++) {
+	    printf("  ");
+	    PrintOpName(opStrings[ops[i].index].string);
+	    printf(" %10u %6.2f%%\n", ops[i].count,
+		   Percent(ops[i].count, total));
+	}
+	ReportHistogram("instructions executed", counts);
+    }
+    if (sampling) {
+	printf("\nProfile: %u timer samples in user code\n", numSamples);
+	ReportHistogram("timer samples", samples);
+    }
+}
@@ -0,0 +1,84 @@
+// profile.h
+//	Data structures for profiling user programs: how often each
+//	instruction (by virtual PC) and each opcode was executed, and
+//	where the PC was at each timer interrupt.
+//
+//	Exact counts are kept by the traced version of the interpreter,
+//	so counting slows user programs down, but an untraced run pays
+//	nothing for it.  Sampling only needs the timer, and works with
+//	every execution mode.
+//
+//	The report printed when Nachos halts can be mapped to function
+//	names, given a symbol table in the format printed by "nm -n"
+//	for the program's COFF file (the test Makefile makes one, as
+//	<program>.sym, next to each NOFF file).
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define ProfileTopN	20	// hot spots and functions to report
+#define ProfileOpcodes	64	// MaxOpcode + 1 (see mipssim.h)
+
+// A text symbol, from the symbol table file.
+class ProfileSymbol {
+  public:
+    unsigned int address;	// where the function starts
+    char *name;
+};
+
+// The following class defines the profiling counters, and the
+// routines the simulation uses to update them.
+
+class Profiler {
+  public:
+    Profiler(bool count, bool sample);
+				// Initialize empty counters; "count" asks
+				// for exact counts, "sample" for samples
+    ~Profiler();		// De-allocate them
+
+    bool IsCounting() { return counting; }
+    bool IsSampling() { return sampling; }
+
+    void Count(int pc, int opCode) {	// Record an executed instruction
+	if ((unsigned) pc / 4 >= (unsigned) numWords)
+	    Grow(pc);
+	counts[pc / 4]++;
+	opCounts[opCode]++;
+    }
+    void Sample(int pc);	// Record the PC at a timer interrupt
+
+    void LoadSymbols(char *fileName);
+				// Read a "nm -n" symbol table, for Report
+    void Report();		// Print the hot spots
+
+  private:
+    void Grow(int pc);		// Make room for counts up to "pc"
+    void ReportHistogram(const char *what, unsigned int *hist);
+				// Print the top entries of "counts" or
+				// "samples", by PC and by function
+    ProfileSymbol *FindSymbol(unsigned int address);
+				// Function containing "address", or NULL
+
+    bool counting;		// keep exact counts?
+    bool sampling;		// take samples?
+    unsigned int *counts;	// executions of the instruction at each PC
+    unsigned int *samples;	// timer interrupts at each PC
+    int numWords;		// size of "counts" and "samples"
+    unsigned int opCounts[ProfileOpcodes];
+				// executions of each opcode
+    unsigned int numSamples;	// total samples taken
+
+    ProfileSymbol *symbols;	// functions, sorted by address
+    int numSymbols;
+};
+
+#endif // PROFILE_H
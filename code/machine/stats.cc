@@ -11,6 +11,93 @@
 #include "utility.h"
 #include "stats.h"
 
+static const char *cacheNames[NumCacheLevels] = { "L1I", "L1D", "L2" };
+static const char *latencyNames[NumLatencyKinds] = { "disk", "consoleRead",
+    "consoleWrite", "netSend", "netRecv", "pageFault", "syscall" };
+
+// The counters, in the order Export writes them.
+static const char *counterNames[] = {
+    "totalTicks", "idleTicks", "systemTicks", "userTicks",
+    "numDiskReads", "numDiskWrites",
+    "numConsoleCharsRead", "numConsoleCharsWritten",
+    "numPageFaults", "numPacketsSent", "numPacketsRecvd",
+    "numTLBHits", "numTLBMisses", "numTLBRefills", "tlbRefillTicks",
+    "numL1IHits", "numL1IMisses", "numL1DHits", "numL1DMisses",
+    "numL2Hits", "numL2Misses", "cacheStallTicks",
+    "numAddrSpaces", "pageTableBytes",
+    "numStacksAllocated", "numStacksPooled"
+};
+#define NumCounters	(int) (sizeof(counterNames) / sizeof(char *))
+
+#define NoExport	0x7fffffffffffffffLL	// nextExport, if none is due
+
+// Where, how and how often the statistics are exported.  These are
+// kept out of Statistics, since restoring a checkpoint overwrites it.
+static FILE *exportFile = NULL;
+static bool exportJSON;
+static int exportInterval;		// 0 to export only at halt
+static long long nextExport = NoExport; // when to export next
+
+//----------------------------------------------------------------------
+// Histogram::Clear
+// 	Make the histogram empty.
+//----------------------------------------------------------------------
+
+void
+Histogram::Clear()
+{
+    count = sum = max = 0;
+    for (int i = 0; i < HistogramBuckets; i++)
+	buckets[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// Histogram::Record
+// 	Count a request that took "ticks" in the bucket for its order of
+//	magnitude: 0 for no time at all, i for 2^(i-1) to 2^i - 1 ticks.
+//----------------------------------------------------------------------
+
+void
+Histogram::Record(long long ticks)
+{
+    int bucket = 0;
+
+    ASSERT(ticks >= 0);
+    for (unsigned long long t = ticks; t != 0; t >>= 1)
+	bucket++;
+    buckets[bucket]++;
+    count++;
+    sum += ticks;
+    if (ticks > max)
+	max = ticks;
+}
+
+//----------------------------------------------------------------------
+// Histogram::Percentile
+// 	Return an upper bound on the latency of the fastest "percent" of
+//	the requests: the top of the bucket the one at that rank falls
+//	in, but no more than the longest latency recorded.  0 if nothing
+//	has been recorded.
+//----------------------------------------------------------------------
+
+long long
+Histogram::Percentile(double percent)
+{
+    long long rank = (long long) (count * percent / 100.0 + 0.5), seen = 0;
+
+    if (rank < 1)
+	rank = 1;
+    for (int i = 0; i < HistogramBuckets; i++) {
+	seen += buckets[i];
+	if (seen >= rank) {
+	    long long top = (long long) ((1ULL << i) - 1);
+
+	    return (top < max) ? top : max;
+	}
+    }
+    return max;
+}
+
 //----------------------------------------------------------------------
 // Statistics::Statistics
 // 	Initialize performance metrics to zero, at system startup.
@@ -22,6 +109,14 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numTLBHits = numTLBMisses = numTLBRefills = tlbRefillTicks = 0;
+    for (int i = 0; i < NumCacheLevels; i++)
+	numCacheHits[i] = numCacheMisses[i] = 0;
+    cacheStallTicks = 0;
+    numAddrSpaces = pageTableBytes = 0;
+    numStacksAllocated = numStacksPooled = 0;
+    for (int i = 0; i < NumLatencyKinds; i++)
+	latency[i].Clear();
 }
 
 //----------------------------------------------------------------------
@@ -33,12 +128,217 @@ Statistics::Statistics()
 void
 Statistics::Print()
 {
-    printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
-	idleTicks, systemTicks, userTicks);
-    printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
-    printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
+    printf("Ticks: total %lld, idle %lld, system %lld, user %lld\n",
+	totalTicks, idleTicks, systemTicks, userTicks);
+    printf("Disk I/O: reads %lld, writes %lld\n", numDiskReads,
+	numDiskWrites);
+    printf("Console I/O: reads %lld, writes %lld\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
-    printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
-	numPacketsSent);
+    printf("Paging: faults %lld\n", numPageFaults);
+    if (numAddrSpaces > 0)
+	printf("Page tables: %lld address spaces, %lld bytes, %lld bytes "
+	       "each on average\n", numAddrSpaces, pageTableBytes,
+	       pageTableBytes / numAddrSpaces);
+    if (numTLBHits + numTLBMisses > 0)
+	printf("TLB: hits %lld, misses %lld (%.2f%% hit rate), refills %lld, "
+	       "refill ticks %lld\n", numTLBHits, numTLBMisses,
+	       100.0 * numTLBHits / (numTLBHits + numTLBMisses),
+	       numTLBRefills, tlbRefillTicks);
+    for (int i = 0; i < NumCacheLevels; i++)
+	if (numCacheHits[i] + numCacheMisses[i] > 0)
+	    printf("Cache %s: hits %lld, misses %lld (%.2f%% hit rate)\n",
+		   cacheNames[i], numCacheHits[i], numCacheMisses[i],
+		   100.0 * numCacheHits[i] / (numCacheHits[i] + numCacheMisses[i]));
+    if (cacheStallTicks > 0)
+	printf("Cache stalls: %lld ticks\n", cacheStallTicks);
+    printf("Network I/O: packets received %lld, sent %lld\n",
+	numPacketsRecvd, numPacketsSent);
+    if (numStacksAllocated > 0)
+	printf("Thread stacks: %lld allocated, %lld from the pool "
+	       "(%.2f%% hit rate)\n", numStacksAllocated, numStacksPooled,
+	       100.0 * numStacksPooled / numStacksAllocated);
+    for (int i = 0; i < NumLatencyKinds; i++)
+	if (latency[i].count > 0)
+	    printf("Latency %s: %lld requests, mean %.1f, p50 %lld, "
+		   "p90 %lld, p99 %lld, max %lld ticks\n", latencyNames[i],
+		   latency[i].count, (double) latency[i].sum / latency[i].count,
+		   latency[i].Percentile(50), latency[i].Percentile(90),
+		   latency[i].Percentile(99), latency[i].max);
+}
+
+//----------------------------------------------------------------------
+// GetCounters
+// 	Copy the counters of "s" into "values", in counterNames order.
+//----------------------------------------------------------------------
+
+static void
+GetCounters(Statistics *s, long long *values)
+{
+    int n = 0;
+
+    values[n++] = s->totalTicks;
+    values[n++] = s->idleTicks;
+    values[n++] = s->systemTicks;
+    values[n++] = s->userTicks;
+    values[n++] = s->numDiskReads;
+    values[n++] = s->numDiskWrites;
+    values[n++] = s->numConsoleCharsRead;
+    values[n++] = s->numConsoleCharsWritten;
+    values[n++] = s->numPageFaults;
+    values[n++] = s->numPacketsSent;
+    values[n++] = s->numPacketsRecvd;
+    values[n++] = s->numTLBHits;
+    values[n++] = s->numTLBMisses;
+    values[n++] = s->numTLBRefills;
+    values[n++] = s->tlbRefillTicks;
+    for (int i = 0; i < NumCacheLevels; i++) {
+	values[n++] = s->numCacheHits[i];
+	values[n++] = s->numCacheMisses[i];
+    }
+    values[n++] = s->cacheStallTicks;
+    values[n++] = s->numAddrSpaces;
+    values[n++] = s->pageTableBytes;
+    values[n++] = s->numStacksAllocated;
+    values[n++] = s->numStacksPooled;
+    ASSERT(n == NumCounters);
+}
+
+//----------------------------------------------------------------------
+// Statistics::StartExport
+// 	Arrange for the statistics to be written to file "fileName" every
+//	"interval" ticks, and when Nachos halts.  If "interval" is 0, they
+//	are only written at halt.
+//
+//	With "json", each export is one line holding a JSON object: why
+//	it was written ("periodic" or "halt"), the counters, and, for each
+//	kind of request, the latency histogram -- its count, mean, 50th,
+//	90th and 99th percentiles and maximum, and the non-empty buckets,
+//	as [highest latency, count] pairs.  Otherwise, each export is one
+//	row of a CSV file, whose first row names the columns; the buckets
+//	are left out.
+//----------------------------------------------------------------------
+
+void
+Statistics::StartExport(char *fileName, bool json, int interval)
+{
+    ASSERT(interval >= 0);
+    exportFile = fopen(fileName, "w");
+    if (exportFile == NULL) {
+	printf("Can't write statistics to %s\n", fileName);
+	return;
+    }
+    exportJSON = json;
+    exportInterval = interval;
+    nextExport = (interval > 0) ? totalTicks + interval : NoExport;
+    if (!json) {
+	fprintf(exportFile, "why");
+	for (int i = 0; i < NumCounters; i++)
+	    fprintf(exportFile, ",%s", counterNames[i]);
+	for (int i = 0; i < NumLatencyKinds; i++)
+	    fprintf(exportFile, ",%sCount,%sMean,%sP50,%sP90,%sP99,%sMax",
+		    latencyNames[i], latencyNames[i], latencyNames[i],
+		    latencyNames[i], latencyNames[i], latencyNames[i]);
+	fprintf(exportFile, "\n");
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::CheckExport
+// 	Export the statistics if "interval" ticks have passed since the
+//	last time.  Called as simulated time advances.  If time jumps
+//	ahead several intervals, there is only one export.
+//----------------------------------------------------------------------
+
+void
+Statistics::CheckExport()
+{
+    if (totalTicks < nextExport)
+	return;
+    Export("periodic");
+    nextExport = totalTicks + exportInterval;
+}
+
+//----------------------------------------------------------------------
+// Statistics::NextExport
+// 	Return when CheckExport will next export the statistics -- a time
+//	that never comes, if there is no periodic export.
+//----------------------------------------------------------------------
+
+long long
+Statistics::NextExport()
+{
+    return nextExport;
+}
+
+//----------------------------------------------------------------------
+// Statistics::FinishExport
+// 	Export the statistics a last time, as Nachos halts, and close the
+//	file.
+//----------------------------------------------------------------------
+
+void
+Statistics::FinishExport()
+{
+    if (exportFile == NULL)
+	return;
+    Export("halt");
+    fclose(exportFile);
+    exportFile = NULL;
+    nextExport = NoExport;
+}
+
+//----------------------------------------------------------------------
+// Statistics::Export
+// 	Write the statistics to the export file, in the format described
+//	at StartExport.
+//
+//	"why" -- "periodic" or "halt"
+//----------------------------------------------------------------------
+
+void
+Statistics::Export(const char *why)
+{
+    long long values[NumCounters];
+    int i, j;
+
+    GetCounters(this, values);
+    if (exportJSON) {
+	fprintf(exportFile, "{\"why\": \"%s\"", why);
+	for (i = 0; i < NumCounters; i++)
+	    fprintf(exportFile, ", \"%s\": %lld", counterNames[i], values[i]);
+	fprintf(exportFile, ", \"latency\": {");
+	for (i = 0; i < NumLatencyKinds; i++) {
+	    Histogram *h = &latency[i];
+	    bool first = TRUE;
+
+	    fprintf(exportFile, "%s\"%s\": {\"count\": %lld, \"mean\": %.1f, "
+		    "\"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"max\": %lld, "
+		    "\"buckets\": [", (i == 0) ? "" : ", ", latencyNames[i],
+		    h->count, (h->count == 0) ? 0.0 : (double) h->sum / h->count,
+		    h->Percentile(50), h->Percentile(90), h->Percentile(99),
+		    h->max);
+	    for (j = 0; j < HistogramBuckets; j++)
+		if (h->buckets[j] > 0) {
+		    fprintf(exportFile, "%s[%lld, %lld]", first ? "" : ", ",
+			    (long long) ((1ULL << j) - 1), h->buckets[j]);
+		    first = FALSE;
+		}
+	    fprintf(exportFile, "]}");
+	}
+	fprintf(exportFile, "}}\n");
+    } else {
+	fprintf(exportFile, "%s", why);
+	for (i = 0; i < NumCounters; i++)
+	    fprintf(exportFile, ",%lld", values[i]);
+	for (i = 0; i < NumLatencyKinds; i++) {
+	    Histogram *h = &latency[i];
+
+	    fprintf(exportFile, ",%lld,%.1f,%lld,%lld,%lld,%lld", h->count,
+		    (h->count == 0) ? 0.0 : (double) h->sum / h->count,
+		    h->Percentile(50), h->Percentile(90), h->Percentile(99),
+		    h->max);
+	}
+	fprintf(exportFile, "\n");
+    }
+    fflush(exportFile);
 }
@@ -13,32 +13,105 @@
 
 #include "copyright.h"
 
+// The levels of the simulated cache hierarchy (see cache.h).
+enum CacheLevel { L1ICache, L1DCache, L2Cache, NumCacheLevels };
+
+// The kinds of request whose latency, in ticks, is kept in a histogram:
+// disk requests (the seek, rotation and transfer time), console and
+// network output (from the request to its completion interrupt),
+// console and network input (from its arrival to the kernel taking it),
+// and page faults and system calls (from the trap to the return to user
+// code, including any time spent waiting).
+enum LatencyKind { DiskLatency, ConsoleReadLatency, ConsoleWriteLatency,
+		   NetSendLatency, NetRecvLatency, PageFaultLatency,
+		   SyscallLatency, NumLatencyKinds };
+
+#define HistogramBuckets 64	// enough for any 64-bit latency
+
+// The following class defines a histogram of latencies, with buckets
+// of exponentially increasing size: bucket 0 counts latencies of 0,
+// and bucket i > 0 latencies from 2^(i-1) up to 2^i - 1.  So recording
+// a latency is cheap, the histogram is small, and yet it says how long
+// the slowest requests took, within a factor of two -- which an average
+// doesn't.
+//
+// A histogram holds no pointers, so that Statistics can be saved in a
+// checkpoint as is.
+
+class Histogram {
+  public:
+    void Clear();			// Forget all latencies recorded
+    void Record(long long ticks);	// Count a request that took "ticks"
+
+    long long Percentile(double percent);
+					// The latency that "percent" of the
+					// requests took no longer than -- the
+					// top of its bucket, or the maximum
+
+    long long count;			// requests recorded
+    long long sum;			// their total latency
+    long long max;			// the longest of them
+    long long buckets[HistogramBuckets];
+};
+
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
-// many user instructions executed, etc.
+// many user instructions executed, etc.  The counters are 64 bits,
+// since a long run can take more than 2^31 ticks.
 //
 // The fields in this class are public to make it easier to update.
 
 class Statistics {
   public:
-    int totalTicks;      	// Total time running Nachos
-    int idleTicks;       	// Time spent idle (no threads to run)
-    int systemTicks;	 	// Time spent executing system code
-    int userTicks;       	// Time spent executing user code
+    long long totalTicks;      	// Total time running Nachos
+    long long idleTicks;       	// Time spent idle (no threads to run)
+    long long systemTicks;	// Time spent executing system code
+    long long userTicks;       	// Time spent executing user code
 				// (this is also equal to # of
 				// user instructions executed)
 
-    int numDiskReads;		// number of disk read requests
-    int numDiskWrites;		// number of disk write requests
-    int numConsoleCharsRead;	// number of characters read from the keyboard
-    int numConsoleCharsWritten; // number of characters written to the display
-    int numPageFaults;		// number of virtual memory page faults
-    int numPacketsSent;		// number of packets sent over the network
-    int numPacketsRecvd;	// number of packets received over the network
+    long long numDiskReads;	// number of disk read requests
+    long long numDiskWrites;	// number of disk write requests
+    long long numConsoleCharsRead; // number of characters read from the
+				// keyboard
+    long long numConsoleCharsWritten; // number of characters written to
+				// the display
+    long long numPageFaults;	// number of virtual memory page faults
+    long long numPacketsSent;	// number of packets sent over the network
+    long long numPacketsRecvd;	// number of packets received over the
+				// network
+    long long numTLBHits;	// number of translations found in the TLB
+    long long numTLBMisses;	// number of translations not in the TLB
+    long long numTLBRefills;	// number of misses refilled by the hardware
+				// page table walker (see -tlbwalk)
+    long long tlbRefillTicks;	// time spent in those refills
+    long long numCacheHits[NumCacheLevels]; // accesses that hit in each
+				// cache
+    long long numCacheMisses[NumCacheLevels]; // and that missed
+    long long cacheStallTicks;	// time spent waiting for cache misses
+    long long numAddrSpaces;	// number of user address spaces created
+    long long pageTableBytes;	// host memory taken by their page tables
+    long long numStacksAllocated; // number of thread stacks allocated
+    long long numStacksPooled;	// how many of them were reused from the
+				// stack pool (see -stackpool)
+
+    Histogram latency[NumLatencyKinds];	// how long requests took
 
     Statistics(); 		// initialize everything to zero
 
     void Print();		// print collected statistics
+
+    void StartExport(char *fileName, bool json, int interval);
+				// Write the statistics to "fileName", as
+				// JSON or CSV, every "interval" ticks (if
+				// not 0) and when Nachos halts
+    void CheckExport();		// Called as time passes; write them, if
+				// it is time to
+    long long NextExport();	// When that will be
+    void FinishExport();	// Write them a last time, at halt
+
+  private:
+    void Export(const char *why);	// Write them now
 };
 
 // Constants used to reflect the relative time an operation would
@@ -56,5 +129,9 @@ class Statistics {
 #define ConsoleTime 	100	// time to read or write one character
 #define NetworkTime 	100   	// time to send or receive one packet
 #define TimerTicks 	100    	// (average) time between timer interrupts
+#define TLBRefillTime	2	// time for the hardware to walk the page
+				// table on a TLB miss
+#define L2CacheTime	10	// time to fetch a line from the L2 cache
+#define MemoryTime	50	// time to fetch a line from main memory
 
 #endif // STATS_H
@@ -36,7 +36,12 @@ extern "C" {
 #include <sys/un.h>
 #include <sys/mman.h>
 #include <sys/errno.h>
-#ifdef HOST_i386
+#ifdef HOST_LINUX
+#include <sys/epoll.h>
+#else
+#include <sys/stat.h>
+#endif
+#if defined(HOST_i386) || defined(HOST_x86_64)
 #include <sys/time.h>
 #endif
 #ifdef HOST_SPARC
@@ -59,7 +64,7 @@ int open(const char *name, int flags, ...);
 #endif
 #endif
 // void signal(int sig, VoidFunctionPtr func); -- this may work now!
-#if defined(HOST_i386) || defined(HOST_ALPHA)
+#if defined(HOST_i386) || defined(HOST_x86_64) || defined(HOST_ALPHA)
 int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
              struct timeval *timeout);
 #else
@@ -68,6 +73,7 @@ int select(int numBits, void *readFds, void *writeFds, void *exceptFds,
 #endif
 #endif
 
+#ifndef HOST_LINUX
 int unlink(char *name);
 int read(int filedes, char *buf, int numBytes);
 int write(int filedes, char *buf, int numBytes);
@@ -75,6 +81,7 @@ int lseek(int filedes, int offset, int whence);
 int tell(int filedes);
 int close(int filedes);
 int unlink(char *name);
+#endif
 
 // definition varies slightly from platform to platform, so don't 
 // define unless gcc complains
@@ -135,7 +142,7 @@ PollFile(int fd)
         pollTime.tv_usec = 0;                 	// no delay
 
 // poll file or socket
-#if defined(HOST_i386) || defined(HOST_ALPHA)
+#if defined(HOST_i386) || defined(HOST_x86_64) || defined(HOST_ALPHA)
     retVal = select(32, (fd_set*)&rfd, (fd_set*)&wfd, (fd_set*)&xfd, &pollTime);
 #else
     retVal = select(32, &rfd, &wfd, &xfd, &pollTime);
@@ -147,6 +154,174 @@ PollFile(int fd)
     return TRUE;
 }
 
+// The files and sockets being watched for input, for WaitForFiles.
+// Regular files can't be waited for (epoll refuses them, and select
+// says they are always ready), so they are simply treated as always
+// having input.
+
+#define MaxWatched	16
+
+static struct {
+    int fd;			// the file, or -1 if the slot is free
+    VoidFunctionPtr handler;	// what to call when it has input
+    _int arg;			// and its argument
+    bool alwaysReady;		// a regular file
+} watched[MaxWatched];
+static int numWatched = 0;
+#ifdef HOST_LINUX
+static int epollFd = -1;	// the epoll instance holding the sockets
+				// and terminals being watched
+#endif
+
+//----------------------------------------------------------------------
+// WatchFile
+// 	Arrange for "handler" to be called with "arg", by WaitForFiles,
+//	when open file or socket "fd" has input to be read.  Watching a
+//	file that is already watched just changes its handler.
+//----------------------------------------------------------------------
+
+void
+WatchFile(int fd, VoidFunctionPtr handler, _int arg)
+{
+    int i, slot = -1;
+
+    for (i = 0; i < MaxWatched; i++)
+	if (watched[i].handler != NULL && watched[i].fd == fd) {
+	    watched[i].handler = handler;
+	    watched[i].arg = arg;
+	    return;
+	} else if ((watched[i].handler == NULL) && (slot == -1))
+	    slot = i;
+    ASSERT(slot != -1);
+
+    watched[slot].fd = fd;
+    watched[slot].handler = handler;
+    watched[slot].arg = arg;
+    watched[slot].alwaysReady = FALSE;
+    numWatched++;
+#ifdef HOST_LINUX
+    struct epoll_event event;
+
+    if (epollFd == -1) {
+	epollFd = epoll_create(MaxWatched);
+	ASSERT(epollFd >= 0);
+    }
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+	ASSERT(errno == EPERM);		// not a socket, pipe or terminal
+	watched[slot].alwaysReady = TRUE;
+    }
+#else
+    struct stat info;
+
+    fstat(fd, &info);
+    watched[slot].alwaysReady = S_ISREG(info.st_mode);
+#endif
+}
+
+//----------------------------------------------------------------------
+// UnwatchFile
+// 	Stop watching "fd" for input; it is all right if it isn't being
+//	watched.
+//----------------------------------------------------------------------
+
+void
+UnwatchFile(int fd)
+{
+    for (int i = 0; i < MaxWatched; i++)
+	if ((watched[i].handler != NULL) && (watched[i].fd == fd)) {
+#ifdef HOST_LINUX
+	    if (!watched[i].alwaysReady)
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+	    watched[i].handler = NULL;
+	    numWatched--;
+	    return;
+	}
+}
+
+//----------------------------------------------------------------------
+// WatchingFiles
+// 	Return TRUE if any file is being watched for input.
+//----------------------------------------------------------------------
+
+bool
+WatchingFiles()
+{
+    return numWatched > 0;
+}
+
+//----------------------------------------------------------------------
+// WaitForFiles
+// 	Wait until at least one watched file has input, and call its
+//	handler -- the handler of every file that has input, in fact.
+//	A handler may watch or unwatch files (including its own).
+//
+//	Returns FALSE if no file had input within "timeout" milliseconds
+//	(-1 means to wait as long as it takes; 0 just checks), or if no
+//	file is being watched.
+//
+//	"timeout" -- how long to wait for input, in milliseconds
+//----------------------------------------------------------------------
+
+bool
+WaitForFiles(int timeout)
+{
+    int ready[MaxWatched], numReady = 0, i, j;
+
+    if (numWatched == 0)
+	return FALSE;
+    for (i = 0; i < MaxWatched; i++)
+	if ((watched[i].handler != NULL) && watched[i].alwaysReady)
+	    ready[numReady++] = watched[i].fd;
+    if (numReady > 0)
+	timeout = 0;			// don't wait, just collect the rest
+
+#ifdef HOST_LINUX
+    struct epoll_event events[MaxWatched];
+    int retVal;
+
+    do
+	retVal = epoll_wait(epollFd, events, MaxWatched, timeout);
+    while ((retVal < 0) && (errno == EINTR));
+    ASSERT(retVal >= 0);
+    for (i = 0; i < retVal; i++)
+	ready[numReady++] = events[i].data.fd;
+#else
+    fd_set readFds;
+    struct timeval pollTime, *wait = NULL;
+    int maxFd = -1;
+
+    FD_ZERO(&readFds);
+    for (i = 0; i < MaxWatched; i++)
+	if ((watched[i].handler != NULL) && !watched[i].alwaysReady) {
+	    FD_SET(watched[i].fd, &readFds);
+	    if (watched[i].fd > maxFd)
+		maxFd = watched[i].fd;
+	}
+    if (timeout >= 0) {
+	pollTime.tv_sec = timeout / 1000;
+	pollTime.tv_usec = (timeout % 1000) * 1000;
+	wait = &pollTime;
+    }
+    if (maxFd >= 0 && select(maxFd + 1, &readFds, NULL, NULL, wait) > 0)
+	for (i = 0; i <= maxFd; i++)
+	    if (FD_ISSET(i, &readFds))
+		ready[numReady++] = i;
+#endif
+
+    // call the handlers, looking each one up again in case an earlier
+    // handler unwatched it
+    for (j = 0; j < numReady; j++)
+	for (i = 0; i < MaxWatched; i++)
+	    if ((watched[i].handler != NULL) && (watched[i].fd == ready[j])) {
+		(*watched[i].handler)(watched[i].arg);
+		break;
+	    }
+    return numReady > 0;
+}
+
 //----------------------------------------------------------------------
 // OpenForWrite
 // 	Open a file for writing.  Create it if it doesn't exist; truncate it 
@@ -238,7 +413,7 @@ Lseek(int fd, int offset, int whence)
 int 
 Tell(int fd)
 {
-#ifdef HOST_i386
+#if defined(HOST_i386) || defined(HOST_x86_64)
     return lseek(fd,0,SEEK_CUR); // 386BSD doesn't have the tell() system call
 #else
     return tell(fd);
@@ -369,7 +544,7 @@ ReadFromSocket(int sockID, char *buffer, int packetSize)
 
     if (retVal != packetSize) {
         perror("in recvfrom");
-#ifdef HOST_ALPHA
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
         printf("called: %lx, got back %d, %d\n", (long) buffer, retVal, errno);
 #else
         printf("called: %x, got back %d, %d\n", (int) buffer, retVal, errno);
@@ -430,7 +605,7 @@ SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
 void 
 CallOnUserAbort(VoidNoArgFunctionPtr func)
 {
-#ifdef HOST_ALPHA
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
     (void)signal(SIGINT, (void (*)(int)) func);
 #else
     (void)signal(SIGINT, (VoidFunctionPtr) func);
@@ -450,6 +625,21 @@ Delay(int seconds)
     (void) sleep((unsigned) seconds);
 }
 
+//----------------------------------------------------------------------
+// HostSeconds
+// 	Return the time of day on the host, in seconds, with microsecond
+//	resolution; for benchmarks that time the simulator itself.
+//----------------------------------------------------------------------
+
+double
+HostSeconds()
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
@@ -495,6 +685,58 @@ Random()
     return rand();
 }
 
+// Thread stacks are recycled rather than handed back to the host, so
+// that forking a thread usually costs a pop off a free list instead of
+// an mmap and two mprotects.  Stacks are pooled by size class -- the
+// usable part rounded up to a power of two number of pages -- and each
+// class keeps at most "poolHighWater" free stacks; beyond that, they
+// go back to the host.  A free stack's first word links it to the next.
+
+#define PoolClasses	16	// size classes: 1 to 2^15 pages
+#define PoolHighWater	64	// default free stacks kept per class
+
+static char *poolFree[PoolClasses];	// free stacks of each class
+static int poolNumFree[PoolClasses];	// how many there are
+static int poolHighWater = PoolHighWater;
+static int pageSize = 0;		// the host's, once we've asked
+
+//----------------------------------------------------------------------
+// PoolClass
+// 	Return the size class of an array with "size" bytes of useful
+//	space, or PoolClasses if it is too big to pool, and set "*pages"
+//	to the number of pages to map for it.
+//----------------------------------------------------------------------
+
+static int
+PoolClass(int size, int *pages)
+{
+    int needed, cls;
+
+    if (pageSize == 0)
+	pageSize = getpagesize();
+    needed = divRoundUp(size, pageSize);
+    for (cls = 0; cls < PoolClasses; cls++)
+	if ((1 << cls) >= needed) {
+	    *pages = 1 << cls;
+	    return cls;
+	}
+    *pages = needed;
+    return PoolClasses;
+}
+
+//----------------------------------------------------------------------
+// SetBoundedArrayPool
+// 	Keep at most "highWater" free arrays of each size class for
+//	AllocBoundedArray to reuse; 0 turns the pool off.
+//----------------------------------------------------------------------
+
+void
+SetBoundedArrayPool(int highWater)
+{
+    ASSERT(highWater >= 0);
+    poolHighWater = highWater;
+}
+
 //----------------------------------------------------------------------
 // AllocBoundedArray
 // 	Return an array, with the two pages just before 
@@ -502,25 +744,54 @@ Random()
 //	the end of the array.  Particularly useful for catching overflow
 //	beyond fixed-size thread execution stacks.
 //
+//	The array is mapped straight from the host, so that the guard
+//	pages are page-aligned and really do catch overflows, and is
+//	taken from the pool of freed arrays of its size class if there
+//	is one.  Its useful part starts at the guard page below it, where
+//	a thread stack would overflow.
+//
 //	Note: Just return the useful part!
 //
 //	"size" -- amount of useful space needed (in bytes)
+//	"pooled" -- set to TRUE if the array came from the pool
 //----------------------------------------------------------------------
 
 char * 
+AllocBoundedArray(int size, bool *pooled)
+{
+    int pages, cls = PoolClass(size, &pages);
+    char *ptr;
+
+    *pooled = (cls < PoolClasses) && (poolFree[cls] != NULL);
+    if (*pooled) {
+	ptr = poolFree[cls];
+	poolFree[cls] = *(char **) ptr;
+	poolNumFree[cls]--;
+    } else {
+	ptr = (char *) mmap(NULL, (pages + 2) * pageSize,
+				PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	ASSERT(ptr != (char *) MAP_FAILED);
+	mprotect(ptr, pageSize, PROT_NONE);
+	mprotect(ptr + (pages + 1) * pageSize, pageSize, PROT_NONE);
+	ptr += pageSize;
+    }
+    return ptr;
+}
+
+char *
 AllocBoundedArray(int size)
 {
-    int pgSize = getpagesize();
-    char *ptr = new char[pgSize * 2 + size];
+    bool pooled;
 
-    mprotect(ptr, pgSize, 0);
-    mprotect(ptr + pgSize + size, pgSize, 0);
-    return ptr + pgSize;
+    return AllocBoundedArray(size, &pooled);
 }
 
 //----------------------------------------------------------------------
 // DeallocBoundedArray
-// 	Deallocate an array of integers, unprotecting its two boundary pages.
+// 	Deallocate an array allocated by AllocBoundedArray: put it back in
+//	the pool, if its size class isn't full, and otherwise return it,
+//	guard pages and all, to the host.
 //
 //	"ptr" -- the array to be deallocated
 //	"size" -- amount of useful space in the array (in bytes)
@@ -529,9 +800,46 @@ AllocBoundedArray(int size)
 void 
 DeallocBoundedArray(char *ptr, int size)
 {
-    int pgSize = getpagesize();
+    int pages, cls = PoolClass(size, &pages);
+
+    if ((cls < PoolClasses) && (poolNumFree[cls] < poolHighWater)) {
+	*(char **) ptr = poolFree[cls];
+	poolFree[cls] = ptr;
+	poolNumFree[cls]++;
+    } else
+	munmap(ptr - pageSize, (pages + 2) * pageSize);
+}
+
+//----------------------------------------------------------------------
+// AllocZeroedArray
+// 	Return a zero-filled array, mapped directly from the host's
+//	virtual memory.  The host only supplies (and zeroes) a page when
+//	it is first touched, so a large simulated physical memory costs
+//	nothing until the user programs actually use it.
+//
+//	"size" -- amount of space needed (in bytes)
+//----------------------------------------------------------------------
+
+char *
+AllocZeroedArray(int size)
+{
+    char *ptr = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    ASSERT(ptr != (char *) MAP_FAILED);
+    return ptr;
+}
+
+//----------------------------------------------------------------------
+// DeallocZeroedArray
+// 	Return an array allocated by AllocZeroedArray to the host.
+//
+//	"ptr" -- the array to be deallocated
+//	"size" -- the size it was allocated with (in bytes)
+//----------------------------------------------------------------------
 
-    mprotect(ptr - pgSize, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-    mprotect(ptr + size, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-    delete [] (ptr - pgSize);
+void 
+DeallocZeroedArray(char *ptr, int size)
+{
+    munmap(ptr, size);
 }
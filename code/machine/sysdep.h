@@ -17,6 +17,16 @@
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
 
+// Event-driven input: rather than polling a file or socket, ask for
+// "handler" to be called with "arg" once it has input to be read.
+// WaitForFiles calls the handlers of the watched files that have input,
+// waiting up to "timeout" milliseconds (forever if -1) for one to; it
+// returns FALSE if none did.
+extern void WatchFile(int fd, VoidFunctionPtr handler, _int arg);
+extern void UnwatchFile(int fd);
+extern bool WatchingFiles();
+extern bool WaitForFiles(int timeout);
+
 // File operations: open/read/write/lseek/close, and check for error
 // For simulating the disk and the console devices.
 extern int OpenForWrite(char *name);
@@ -44,6 +54,9 @@ extern void Abort();
 extern void Exit(int exitCode);
 extern void Delay(int seconds);
 
+// Time on the host, for measuring how fast Nachos itself runs
+extern double HostSeconds();
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 
@@ -54,8 +67,18 @@ extern int Random();
 // Allocate, de-allocate an array, such that de-referencing
 // just beyond either end of the array will cause an error
 extern char *AllocBoundedArray(int size);
+extern char *AllocBoundedArray(int size, bool *pooled);
+				// and tell whether it was reused
 extern void DeallocBoundedArray(char *p, int size);
 
+// Keep at most "highWater" freed bounded arrays of each size for reuse
+extern void SetBoundedArrayPool(int highWater);
+
+// Allocate, de-allocate a zero-filled array, whose pages are only
+// materialized (and zeroed) when first touched
+extern char *AllocZeroedArray(int size);
+extern void DeallocZeroedArray(char *p, int size);
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
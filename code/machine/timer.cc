@@ -48,8 +48,55 @@ Timer::Timer(VoidFunctionPtr timerHandler, _int callArg, bool doRandom)
     arg = callArg; 
 
     // schedule the first interrupt from the timer device
-    interrupt->Schedule(TimerHandler, (_int) this, TimeOfNextInterrupt(), 
-		TimerInt); 
+    next = interrupt->Schedule(TimerHandler, (_int) this,
+			       TimeOfNextInterrupt(), TimerInt); 
+}
+
+//----------------------------------------------------------------------
+// Timer::~Timer
+//      De-allocate the timer, cancelling its next interrupt.
+//----------------------------------------------------------------------
+
+Timer::~Timer()
+{
+    interrupt->Cancel(next);
+}
+
+//----------------------------------------------------------------------
+// Timer::Start
+//      Start the timer again after Stop.  The first interrupt comes a
+//	full interval from now.  If the timer is running, leave it be, so
+//	that starting it repeatedly doesn't put off the next interrupt.
+//----------------------------------------------------------------------
+
+void
+Timer::Start()
+{
+    if (!interrupt->IsPending(next))
+	next = interrupt->Schedule(TimerHandler, (_int) this,
+				   TimeOfNextInterrupt(), TimerInt);
+}
+
+//----------------------------------------------------------------------
+// Timer::Stop
+//      Stop the timer; no more interrupts come until Start is called.
+//----------------------------------------------------------------------
+
+void
+Timer::Stop()
+{
+    interrupt->Cancel(next);
+}
+
+//----------------------------------------------------------------------
+// Timer::IsRunning
+//      Return TRUE unless the timer is stopped.
+//----------------------------------------------------------------------
+
+bool
+Timer::IsRunning()
+{
+    return interrupt->IsPending(next);
 }
 
 //----------------------------------------------------------------------
@@ -62,8 +109,8 @@ void
 Timer::TimerExpired() 
 {
     // schedule the next timer device interrupt
-    interrupt->Schedule(TimerHandler, (_int) this, TimeOfNextInterrupt(), 
-		TimerInt);
+    next = interrupt->Schedule(TimerHandler, (_int) this,
+			       TimeOfNextInterrupt(), TimerInt);
 
     // invoke the Nachos interrupt handler for this device
     (*handler)(arg);
@@ -11,6 +11,10 @@
 //	In order to introduce some randomness into time-slicing, if "doRandom"
 //	is set, then the interrupt comes after a random number of ticks.
 //
+//	The timer can be stopped and started again, so that a kernel need
+//	not take timer interrupts when there is nothing to time-slice
+//	between.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -22,6 +26,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "interrupt.h"
 
 // The following class defines a hardware timer. 
 class Timer {
@@ -29,7 +34,12 @@ class Timer {
     Timer(VoidFunctionPtr timerHandler, _int callArg, bool doRandom);
 				// Initialize the timer, to call the interrupt
 				// handler "timerHandler" every time slice.
-    ~Timer() {}
+    ~Timer();			// Stop the timer
+
+    void Start();		// Start generating interrupts again, if
+				// stopped; if already running, do nothing
+    void Stop();		// Stop generating interrupts
+    bool IsRunning();		// Is an interrupt coming?
 
 // Internal routines to the timer emulation -- DO NOT call these
 
@@ -43,6 +53,7 @@ class Timer {
     bool randomize;		// set if we need to use a random timeout delay
     VoidFunctionPtr handler;	// timer interrupt handler 
     _int arg;			// argument to pass to interrupt handler
+    IntHandle next;		// the next interrupt, if running
 
 };
 
@@ -0,0 +1,134 @@
+// tlb.cc
+//	Routines to emulate the organization of a set-associative
+//	translation lookaside buffer.  See tlb.h for details.
+//
+//	The "clock" used for LRU and FIFO is just a counter of TLB
+//	operations, not simulated time; only the order of events matters.
+//	Random replacement uses its own generator, so that it doesn't
+//	disturb the random yields (-rs) of the rest of the simulation.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "tlb.h"
+
+//----------------------------------------------------------------------
+// TLB::TLB
+// 	Initialize an empty TLB.
+//
+//	"numEntries" -- total number of entries
+//	"numWays" -- entries per set; must divide "numEntries"
+//	"replace" -- which entry of a full set to replace
+//----------------------------------------------------------------------
+
+TLB::TLB(int numEntries, int numWays, ReplacePolicy replace)
+{
+    ASSERT((numWays > 0) && (numEntries % numWays == 0));
+
+    size = numEntries;
+    ways = numWays;
+    sets = numEntries / numWays;
+    policy = replace;
+    entries = new TranslationEntry[size];
+    tags = new int[size];
+    stamps = new unsigned int[size];
+    for (int i = 0; i < size; i++) {
+	entries[i].valid = FALSE;
+	tags[i] = 0;
+	stamps[i] = 0;
+    }
+    clock = 0;
+    seed = 1;
+}
+
+//----------------------------------------------------------------------
+// TLB::~TLB
+// 	De-allocate the TLB.
+//----------------------------------------------------------------------
+
+TLB::~TLB()
+{
+    delete [] entries;
+    delete [] tags;
+    delete [] stamps;
+}
+
+//----------------------------------------------------------------------
+// TLB::Lookup
+// 	Search the set that "vpn" maps to for a valid entry belonging to
+//	address space "asid".  Returns the entry, or NULL on a miss.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+TLB::Lookup(unsigned int vpn, int asid)
+{
+    int first = (vpn % sets) * ways;
+
+    clock++;
+    for (int i = first; i < first + ways; i++)
+	if (entries[i].valid && (tags[i] == asid) &&
+		((unsigned int) entries[i].virtualPage == vpn)) {
+	    if (policy == LRUReplace)
+		stamps[i] = clock;
+	    return &entries[i];
+	}
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// TLB::Refill
+// 	Load a copy of "entry" into the set its virtual page maps to,
+//	tagged with "asid".  An invalid entry is used if there is one;
+//	otherwise the victim is chosen by the replacement policy.
+//
+//	Returns the new TLB entry.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+TLB::Refill(TranslationEntry *entry, int asid)
+{
+    int first = ((unsigned int) entry->virtualPage % sets) * ways;
+    int victim = -1;
+
+    clock++;
+    for (int i = first; i < first + ways; i++)
+	if (!entries[i].valid) {
+	    victim = i;
+	    break;
+	}
+    if (victim == -1) {
+	if (policy == RandomReplace) {
+	    seed = seed * 1103515245 + 12345;
+	    victim = first + (seed >> 16) % ways;
+	} else {			// LRU or FIFO: the oldest stamp
+	    victim = first;
+	    for (int i = first + 1; i < first + ways; i++)
+		if (stamps[i] < stamps[victim])
+		    victim = i;
+	}
+    }
+    entries[victim] = *entry;
+    tags[victim] = asid;
+    stamps[victim] = clock;
+    return &entries[victim];
+}
+
+//----------------------------------------------------------------------
+// TLB::Invalidate
+// 	Invalidate every entry belonging to address space "asid" (or
+//	every entry, if "asid" is AllSpaces).  The kernel must do this
+//	when it changes a page table entry the TLB may hold a copy of,
+//	or before it reuses an address space ID.
+//----------------------------------------------------------------------
+
+void
+TLB::Invalidate(int asid)
+{
+    for (int i = 0; i < size; i++)
+	if ((asid == AllSpaces) || (tags[i] == asid))
+	    entries[i].valid = FALSE;
+}
@@ -0,0 +1,69 @@
+// tlb.h
+//	Data structures to emulate the organization of a translation
+//	lookaside buffer: how many ways each set has, which entry is
+//	replaced on a refill, and which address space each entry
+//	belongs to.
+//
+//	The entries themselves are ordinary TranslationEntry's, stored
+//	set by set in "entries" (which Machine::tlb points to), so the
+//	kernel can still read them directly.  Each entry is also tagged
+//	with an address space ID (ASID), so that switching address
+//	spaces doesn't require flushing the TLB.
+//
+//	Writing an entry directly leaves its slot's ASID tag alone, and
+//	Lookup only searches the set the virtual page maps to, so that
+//	only works for a fully associative TLB used with ASID 0 (the
+//	original Nachos setup).  Otherwise, load entries with Refill
+//	and remove them with Invalidate.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TLBCACHE_H
+#define TLBCACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "translate.h"
+
+// Which entry of a full set to replace on a refill (also used by the
+// caches, see cache.h).
+enum ReplacePolicy { LRUReplace, FIFOReplace, RandomReplace };
+
+#define AllSpaces	-1	// for TLB::Invalidate, every address space
+
+// The following class defines an N-way set-associative TLB.
+// A TLB with as many ways as entries is fully associative; one
+// with a single way is direct mapped.
+
+class TLB {
+  public:
+    TLB(int numEntries, int numWays, ReplacePolicy replace);
+				// Initialize an empty TLB
+    ~TLB();			// De-allocate it
+
+    TranslationEntry *Lookup(unsigned int vpn, int asid);
+				// Return the valid entry mapping "vpn" in
+				// address space "asid", or NULL
+    TranslationEntry *Refill(TranslationEntry *entry, int asid);
+				// Copy "entry" into the TLB, replacing
+				// some entry in its set; return the copy
+    void Invalidate(int asid);	// Invalidate all entries of "asid"
+
+    TranslationEntry *entries;	// the entries, set by set
+    int size;			// number of entries
+
+  private:
+    int ways;			// entries per set
+    int sets;			// number of sets
+    ReplacePolicy policy;	// how to choose a victim
+    int *tags;			// address space ID of each entry
+    unsigned int *stamps;	// time of last use (LRU) or of refill (FIFO)
+    unsigned int clock;		// advanced on every lookup and refill
+    unsigned int seed;		// for RandomReplace
+};
+
+#endif // TLBCACHE_H
@@ -104,7 +104,7 @@ Consumer(_int which)
     // to form a output file name for this consumer thread.
     // all the messages received by this consumer will be recorded in 
     // this file.
-    sprintf(fname, "tmp_%d", which);
+    sprintf(fname, "tmp_%d", (int) which);
 
     // create a file. Note that this is a UNIX system call.
     if ( (fd = creat(fname, 0600) ) == -1) 
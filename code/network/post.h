@@ -68,6 +68,8 @@ class Mail {
      PacketHeader pktHdr;	// Header appended by Network
      MailHeader mailHdr;	// Header appended by PostOffice
      char data[MaxMailSize];	// Payload -- message data
+
+     ListLink<Mail> link;	// for the mailbox it is waiting in
 };
 
 // The following class defines a single mailbox, or temporary storage
@@ -87,7 +89,8 @@ class MailBox {
 				// mailbox (and wait if there is no message 
 				// to get!)
   private:
-    SynchList *messages;	// A mailbox is just a list of arrived messages
+    SynchIntrusiveList<Mail, &Mail::link> *messages;
+				// A mailbox is just a list of arrived messages
 };
 
 // The following class defines a "Post Office", or a collection of 
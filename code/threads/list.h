@@ -6,6 +6,9 @@
 //	pending interrupts, etc.  That is why each item is a "void *",
 //	or in other words, a "pointers to anything".
 //
+//	Putting an item on a List allocates a cell for it; the hot
+//	lists use IntrusiveList, below, which doesn't.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -57,10 +60,196 @@ class List {
     // Routines to put/get items on/off list in order (sorted by key)
     void SortedInsert(void *item, int sortKey);	// Put item into list
     void *SortedRemove(int *keyPtr); 	  	// Remove first item from list
+    void *SortedPeek(int *keyPtr);		// Return first item, leaving it
+						// on the list
 
   private:
     ListElement *first;  	// Head of the list, NULL if list is empty
     ListElement *last;		// Last element of list
 };
 
+// The following classes define an "intrusive" list: instead of a
+// ListElement being allocated for each item put on the list, the link
+// is kept in the item itself, so putting an item on the list and
+// taking it off never allocates.  The lists the kernel uses on every
+// context switch and every wakeup -- the ready list, semaphore and
+// condition variable queues -- are intrusive.
+//
+// The price is that the list has to know the type of its items, and
+// where in them their link is, and that an item can only be on one
+// list per link at a time; a Thread, for instance, has one link, since
+// it is either ready to run or waiting on one thing, but never both.
+// The link is named by a pointer to member, so that an item can have
+// more than one, if it needs to be on several lists at once:
+//
+//	class Thread {
+//	  public:
+//	    ListLink<Thread> queueLink;
+//	    ...
+//	};
+//	IntrusiveList<Thread, &Thread::queueLink> readyList;
+
+template <class T>
+class ListLink {
+  public:
+    ListLink() { next = NULL; key = 0; }
+
+    T *next;			// next item on the list,
+				// NULL if this is the last
+    int key;			// priority, for a sorted list
+};
+
+template <class T, ListLink<T> T::*link>
+class IntrusiveList {
+  public:
+    IntrusiveList() { first = last = NULL; }	// initialize the list
+				// (items still on it when it is
+				// de-allocated are simply dropped)
+
+    void Prepend(T *item);	// Put item at the beginning of the list
+    void Append(T *item);	// Put item at the end of the list
+    T *Remove();		// Take item off the front of the list
+
+    void Mapcar(VoidFunctionPtr func);	// Apply "func" to every element
+					// on the list
+    bool IsEmpty() { return first == NULL; }
+
+    // Routines to put/get items on/off list in order (sorted by key)
+    void SortedInsert(T *item, int sortKey);	// Put item into list
+    T *SortedRemove(int *keyPtr);		// Remove first item from list
+
+  private:
+    T *first;			// Head of the list, NULL if list is empty
+    T *last;			// Last item on the list
+};
+
+//----------------------------------------------------------------------
+// IntrusiveList::Prepend
+//      Put an "item" on the front of the list.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*link>
+void
+IntrusiveList<T, link>::Prepend(T *item)
+{
+    (item->*link).key = 0;
+    (item->*link).next = first;
+    if (first == NULL)
+	last = item;
+    first = item;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::Append
+//      Put an "item" on the end of the list.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*link>
+void
+IntrusiveList<T, link>::Append(T *item)
+{
+    (item->*link).key = 0;
+    (item->*link).next = NULL;
+    if (first == NULL)
+	first = item;
+    else
+	(last->*link).next = item;
+    last = item;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::Remove
+//      Remove the first item from the front of the list.
+//
+// Returns:
+//	Pointer to removed item, NULL if nothing on the list.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*link>
+T *
+IntrusiveList<T, link>::Remove()
+{
+    return SortedRemove(NULL);
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::Mapcar
+//	Apply a function to each item on the list, by walking through
+//	the list, one item at a time.
+//
+//	"func" is the procedure to apply to each item on the list.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*link>
+void
+IntrusiveList<T, link>::Mapcar(VoidFunctionPtr func)
+{
+    for (T *ptr = first; ptr != NULL; ptr = (ptr->*link).next)
+	(*func)((_int) ptr);
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::SortedInsert
+//      Insert an "item" into a list, so that the list items are sorted
+//	in increasing order by "sortKey"; items with the same key stay
+//	in the order they were inserted.
+//
+//	"item" is the thing to put on the list.
+//	"sortKey" is the priority of the item.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*link>
+void
+IntrusiveList<T, link>::SortedInsert(T *item, int sortKey)
+{
+    T *ptr;
+
+    (item->*link).key = sortKey;
+    if ((first == NULL) || (sortKey < (first->*link).key)) {
+	(item->*link).next = first;	// item goes on front of list
+	if (first == NULL)
+	    last = item;
+	first = item;
+	return;
+    }
+    for (ptr = first; (ptr->*link).next != NULL; ptr = (ptr->*link).next)
+	if (sortKey < ((ptr->*link).next->*link).key)
+	    break;
+    (item->*link).next = (ptr->*link).next;	// item goes after ptr
+    (ptr->*link).next = item;
+    if (ptr == last)
+	last = item;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::SortedRemove
+//      Remove the first item from the front of a sorted list.
+//
+// Returns:
+//	Pointer to removed item, NULL if nothing on the list.
+//	Sets *keyPtr to the priority value of the removed item, if
+//	"keyPtr" isn't NULL.
+//
+//	"keyPtr" is a pointer to the location in which to store the
+//		priority of the removed item.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*link>
+T *
+IntrusiveList<T, link>::SortedRemove(int *keyPtr)
+{
+    T *item = first;
+
+    if (item == NULL)
+	return NULL;
+    if (first == last)		// list had one item, now has none
+	first = last = NULL;
+    else
+	first = (item->*link).next;
+    (item->*link).next = NULL;
+    if (keyPtr != NULL)
+	*keyPtr = (item->*link).key;
+    return item;
+}
+
 #endif // LIST_H
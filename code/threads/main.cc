@@ -8,8 +8,17 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+// Usage: nachos -d <debugflags> -rs <random seed #> -tickless -pollio
+//		-sched <fifo|mlfq> -sb -statsout <file> <json|csv> <ticks>
+//		-stackpool <stacks> -stackpaint
+//		-ib <events> <depth> -cs <switches> -ct <threads>
+//		-s -bb -jit -jd -mem <pages> -tlb <entries>
+//		-tlbways <ways> -tlbpolicy <lru|fifo|random> -tlbwalk
+//		-pt <linear|radix|inverted>
+//		-l1i|-l1d|-l2 <rows> <assoc> <linesize> <lru|fifo|random>
+//		-prof -profsample -profsyms <symbol file>
+//		-checkpoint <file> <ticks> -restore <file>
+//		-x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -e <network orderability>
@@ -19,11 +28,76 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -sched starts the timer, time-slicing every TimerTicks ticks (unless
+//	  -rs), and chooses the scheduling policy: first come first served
+//	  (the default), or a multilevel feedback queue that favors
+//	  threads which block, like interactive ones
+//    -sb times how soon an interactive thread gets the CPU after each
+//	  (simulated) keystroke, while CPU-bound threads compete for it;
+//	  compare "-sched fifo -sb" with "-sched mlfq -sb"
+//    -tickless runs the -rs timer only while some thread is waiting for
+//	  the CPU, so that a thread running alone isn't interrupted, and
+//	  an idle machine skips straight to the next device interrupt
+//	  (ignored with -profsample, which needs every timer interrupt)
+//    -statsout writes the statistics, with latency histograms for disk,
+//	  console and network requests, page faults and system calls, to
+//	  <file> every <ticks> ticks (if not 0) and at halt, one JSON
+//	  object per line or one CSV row each time
+//    -stackpool keeps up to <stacks> freed thread stacks of each size
+//	  to reuse, instead of returning them to the host (64 by default;
+//	  0 turns the pool off); the statistics report how often a new
+//	  thread got its stack from the pool
+//    -stackpaint fills each new thread stack with a known pattern, so
+//	  that each thread can report, when it finishes, the most stack
+//	  it used -- to pick the size to give the Thread constructor for
+//	  threads that are created by the thousand
+//    -pollio makes the console and network poll for input every so many
+//	  ticks, so that a run with the same input takes the same interrupts
+//	  at the same simulated times; by default they wait for the host to
+//	  say input has arrived, and an idle machine sleeps until it does
+//    -ib times the pending interrupt queue: <events> interrupts are
+//	  scheduled and fired, with <depth> of them pending at a time
+//    -cs times context switches: two threads yield to each other
+//	  <switches> times, on the host clock (best without -rs or -sched,
+//	  so that nothing else is switched to)
+//    -ct forks <threads> threads that wait without their stacks, first
+//	  on a semaphore, then for a lock, then on a condition, and checks
+//	  that they all get through
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -bb runs user programs a basic block at a time (same timing as
+//	  the default one-instruction-at-a-time interpreter)
+//    -jit is like -bb, but also compiles frequently executed blocks
+//    -jd is like -jit, but checks each compiled instruction against the
+//	  interpreter, and aborts on any difference
+//    -mem sets the size of physical memory, in pages
+//    -tlb sets the number of TLB entries (if the TLB is in use)
+//    -tlbways sets the number of entries per TLB set (default: fully
+//	  associative)
+//    -tlbpolicy chooses which entry of a full TLB set is replaced
+//    -tlbwalk puts a TLB in front of the page table, refilled by a
+//	  hardware page table walker instead of by the kernel
+//    -pt chooses the page table format: a linear table (the default),
+//	  a two-level radix table, or one inverted table for all of
+//	  physical memory; with the last two, the stack is put at the top
+//	  of a 2GB address space (only the userprog kernel supports them)
+//    -l1i, -l1d and -l2 simulate a level 1 instruction or data cache,
+//	  or a unified level 2 cache, of <rows> sets of <assoc> lines of
+//	  <linesize> bytes, and add the time taken by misses (user
+//	  programs then always run under the interpreter)
+//    -prof counts how often each user instruction and opcode is executed
+//	  (under the interpreter), and prints the hot spots at halt
+//    -profsample samples the user PC at each timer interrupt (starting
+//	  the timer if -rs didn't), and prints the hot spots at halt
+//    -profsyms names the functions in the profile, from the output of
+//	  "nm -n" for the program (test/<program>.sym)
 //    -x runs a user program
+//    -checkpoint saves the running user program to a host file, <ticks>
+//	  from now (so it must come before -x or -restore)
+//    -restore resumes a user program saved by -checkpoint, with the same
+//	  -mem; the clock and statistics carry on from the checkpoint
 //    -c tests the console
 //
 //  FILESYS
@@ -61,8 +135,11 @@
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
+extern void ScheduleCheckpoint(char *file, int ticks);
+extern void RestoreProcess(char *file);
 extern void MailTest(int networkID);
-extern void SynchTest(void);
+extern void SynchTest(void), SchedulerBenchmark(void);
+extern void SwitchBenchmark(int switches), ContinuationTest(int threads);
 
 //----------------------------------------------------------------------
 // main
@@ -98,11 +175,34 @@ main(int argc, char **argv)
 	argCount = 1;
         if (!strcmp(*argv, "-z"))               // print copyright
             printf (copyright);
+        else if (!strcmp(*argv, "-ib")) {	// interrupt queue benchmark
+	    ASSERT(argc > 2);
+	    interrupt->Benchmark(atoi(*(argv + 1)), atoi(*(argv + 2)));
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-sb")) {	// scheduler benchmark
+	    SchedulerBenchmark();
+	} else if (!strcmp(*argv, "-cs")) {	// context switch benchmark
+	    ASSERT(argc > 1);
+	    SwitchBenchmark(atoi(*(argv + 1)));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ct")) {	// continuation thread test
+	    ASSERT(argc > 1);
+	    ContinuationTest(atoi(*(argv + 1)));
+	    argCount = 2;
+	}
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-x")) {        	// run a user program
 	    ASSERT(argc > 1);
             StartProcess(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-checkpoint")) { // save it later on
+	    ASSERT(argc > 2);
+	    ScheduleCheckpoint(*(argv + 1), atoi(*(argv + 2)));
+	    argCount = 3;
+        } else if (!strcmp(*argv, "-restore")) { // resume a saved program
+	    ASSERT(argc > 1);
+            RestoreProcess(*(argv + 1));
+            argCount = 2;
         } else if (!strcmp(*argv, "-c")) {      // test the console
 	    if (argc == 1)
 	        ConsoleTest(NULL, NULL);
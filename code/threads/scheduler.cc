@@ -11,8 +11,9 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	By default, a very simple implementation -- no priorities,
+//	straight FIFO.  A multilevel feedback queue can be chosen instead
+//	(see scheduler.h).
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -29,7 +30,13 @@
 
 Scheduler::Scheduler()
 { 
-    readyList = new List; 
+    readyList = new ThreadList; 
+    tickless = FALSE;
+    policy = FIFOPolicy;
+    for (int i = 0; i < MLFQLevels; i++)
+	levels[i] = new ThreadList;
+    sliceStart = 0;
+    nextBoost = MLFQBoostTime;
 } 
 
 //----------------------------------------------------------------------
@@ -40,6 +47,8 @@ Scheduler::Scheduler()
 Scheduler::~Scheduler()
 { 
     delete readyList; 
+    for (int i = 0; i < MLFQLevels; i++)
+	delete levels[i];
 } 
 
 //----------------------------------------------------------------------
@@ -56,7 +65,12 @@ Scheduler::ReadyToRun (Thread *thread)
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
     thread->setStatus(READY);
-    readyList->Append((void *)thread);
+    if (policy == MLFQPolicy)
+	levels[thread->getLevel()]->Append(thread);
+    else
+	readyList->Append(thread);
+    if (tickless)
+	timer->Start();		// there is now something to time-slice to
 }
 
 //----------------------------------------------------------------------
@@ -70,7 +84,41 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    if (policy == MLFQPolicy) {
+	int level = HighestLevel();
+
+	return (level == MLFQLevels) ? NULL : levels[level]->Remove();
+    }
+    return readyList->Remove();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HasReadyThreads
+// 	Return TRUE if any thread is waiting to run.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::HasReadyThreads()
+{
+    if (policy == MLFQPolicy)
+	return HighestLevel() < MLFQLevels;
+    return !readyList->IsEmpty();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HighestLevel
+// 	Return the highest priority (lowest numbered) MLFQ level that has
+//	a thread ready to run, or MLFQLevels if there is none.
+//----------------------------------------------------------------------
+
+int
+Scheduler::HighestLevel()
+{
+    int level = 0;
+
+    while ((level < MLFQLevels) && levels[level]->IsEmpty())
+	level++;
+    return level;
 }
 
 //----------------------------------------------------------------------
@@ -102,6 +150,14 @@ Scheduler::Run (Thread *nextThread)
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    if (tickless && !HasReadyThreads())
+	timer->Stop();			    // nobody to preempt nextThread for
+    sliceStart = stats->totalTicks;	    // its time slice starts now
+
+    if (nextThread != oldThread) {	    // threads blocked without a
+	oldThread->DropStack();		    // stack give up the old one,
+	nextThread->StartOver();	    // and get a new one to run on
+    }
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
     
@@ -118,13 +174,11 @@ Scheduler::Run (Thread *nextThread)
     DEBUG('t', "Now in thread \"%s\"\n", currentThread->getName());
 
     // If the old thread gave up the processor because it was finishing,
-    // we need to delete its carcass.  Note we cannot delete the thread
+    // we need to delete its carcass (or if it blocked without its
+    // stack, free that).  Note we cannot delete the thread
     // before now (for example, in Thread::Finish()), because up to this
     // point, we were still running on the old thread's stack!
-    if (threadToBeDestroyed != NULL) {
-        delete threadToBeDestroyed;
-	threadToBeDestroyed = NULL;
-    }
+    SwitchDone();
     
 #ifdef USER_PROGRAM
     if (currentThread->space != NULL) {		// if there is an address space
@@ -134,6 +188,123 @@ Scheduler::Run (Thread *nextThread)
 #endif
 }
 
+//----------------------------------------------------------------------
+// Scheduler::SetTickless
+// 	Turn tickless time-slicing on or off.  When it is on, the timer
+//	runs only while some thread is on the ready list; one thread
+//	running alone isn't interrupted, and an idle machine skips
+//	straight to the next device interrupt.  ReadyToRun starts the
+//	timer, and Run stops it when the thread it switches to is the
+//	only one that can run.
+//
+//	"on" -- TRUE to stop the timer whenever the ready list is empty;
+//		FALSE to leave it running (it must be started again by
+//		the caller, if need be)
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetTickless(bool on)
+{
+    ASSERT(!on || (timer != NULL));
+    tickless = on;
+    if (tickless && !HasReadyThreads())
+	timer->Stop();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetPolicy
+// 	Choose how the next thread to run is picked.  No thread may be
+//	ready when the policy changes (so call this before forking any).
+//	With MLFQPolicy, the timer must be running, for the time quanta.
+//
+//	"newPolicy" -- FIFOPolicy or MLFQPolicy
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetPolicy(SchedPolicy newPolicy)
+{
+    ASSERT(!HasReadyThreads());
+    ASSERT((newPolicy == FIFOPolicy) || (timer != NULL));
+    policy = newPolicy;
+    nextBoost = stats->totalTicks + MLFQBoostTime;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::TimerTick
+// 	Called by the timer interrupt handler, to decide whether the
+//	running thread is to be preempted.  With FIFOPolicy it always is,
+//	so that ready threads run round robin, one time slice each.
+//
+//	With MLFQPolicy, the running thread keeps the CPU until it has run
+//	for the quantum of its level, and then drops a level -- unless a
+//	thread of higher priority has become ready, in which case that
+//	thread gets the CPU now.  Either way, there is only a switch if
+//	some ready thread is at least as important as the running one.
+//	Every MLFQBoostTime ticks, all threads go back to the top level.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::TimerTick()
+{
+    int level;
+
+    if (policy != MLFQPolicy)
+	return TRUE;
+    if (stats->totalTicks >= nextBoost)
+	Boost();
+    level = currentThread->getLevel();
+    if (stats->totalTicks - sliceStart >= MLFQQuantum(level)) {
+	if (level < MLFQLevels - 1) {
+	    DEBUG('t', "Thread \"%s\" used its quantum, demoted to level %d\n",
+		  currentThread->getName(), level + 1);
+	    currentThread->setLevel(++level);
+	}
+	sliceStart = stats->totalTicks;	// a new quantum, if nobody
+					// else can run
+	return HighestLevel() <= level;
+    }
+    return HighestLevel() < level;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Blocked
+// 	Called as the running thread goes to sleep.  With MLFQPolicy, a
+//	thread that blocks before its quantum is up -- that waits for I/O,
+//	or for another thread -- rises a level.
+//
+//	"thread" is the thread going to sleep.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Blocked(Thread *thread)
+{
+    if ((policy == MLFQPolicy) && (thread->getLevel() > 0))
+	thread->setLevel(thread->getLevel() - 1);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+// 	Move the running thread and all ready threads to the top MLFQ
+//	level, so that threads which were demoted for using the CPU a lot
+//	in the past, but are now waiting on it, can't starve.  (Blocked
+//	threads are left alone; they rise as they block.)
+//----------------------------------------------------------------------
+
+void
+Scheduler::Boost()
+{
+    Thread *thread;
+
+    DEBUG('t', "Boosting all threads to the top level\n");
+    nextBoost = stats->totalTicks + MLFQBoostTime;
+    currentThread->setLevel(0);
+    for (int i = 1; i < MLFQLevels; i++)
+	while ((thread = levels[i]->Remove()) != NULL) {
+	    thread->setLevel(0);
+	    levels[0]->Append(thread);
+	}
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Print
 // 	Print the scheduler state -- in other words, the contents of
@@ -143,5 +314,12 @@ void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    if (policy == MLFQPolicy)
+	for (int i = 0; i < MLFQLevels; i++) {
+	    printf("level %d: ", i);
+	    levels[i]->Mapcar((VoidFunctionPtr) ThreadPrint);
+	    printf("\n");
+	}
+    else
+	readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
 }
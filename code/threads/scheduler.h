@@ -13,6 +13,22 @@
 #include "list.h"
 #include "thread.h"
 
+// The scheduling policies.  FIFOPolicy runs threads in the order
+// they became ready, time-slicing between them if the timer is on.
+// MLFQPolicy is a multilevel feedback queue: a ready queue per
+// priority level, each with its own time quantum, twice as long as
+// the one above it.  A thread that uses up its quantum drops a level,
+// one that blocks rises a level, and every so often all the threads
+// that can run go back to the top, so that none starves.  Threads
+// that mostly wait -- for the console, say -- so stay near the top,
+// and run soon after they wake, ahead of threads that compute.
+enum SchedPolicy { FIFOPolicy, MLFQPolicy };
+
+#define MLFQLevels	4			// priority levels
+#define MLFQQuantum(level) (TimerTicks << (level))	// time slice at each
+#define MLFQBoostTime	(TimerTicks * 50)	// how often everyone goes
+						// back to the top level
+
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
@@ -27,10 +43,32 @@ class Scheduler {
 					// list, if any, and return thread.
     void Run(Thread* nextThread);	// Cause nextThread to start running
     void Print();			// Print contents of ready list
+    bool HasReadyThreads();		// Is any thread waiting to run?
+    void SetTickless(bool on);		// Only run the timer when some
+					// thread is waiting for the CPU
+
+    void SetPolicy(SchedPolicy newPolicy);
+					// Choose the policy (FIFO by default),
+					// before any thread is ready
+    bool TimerTick();			// Called on each timer interrupt;
+					// should the running thread yield?
+    void Blocked(Thread* thread);	// The running thread is going
+					// to sleep
     
   private:
-    List *readyList;  		// queue of threads that are ready to run,
+    int HighestLevel();			// The highest level with a ready
+					// thread; MLFQLevels if none
+    void Boost();			// Move every thread to the top level
+
+    ThreadList *readyList;	// queue of threads that are ready to run,
 				// but not running
+    bool tickless;		// stop the timer while the ready list
+				// is empty
+    SchedPolicy policy;		// how to choose the next thread
+    ThreadList *levels[MLFQLevels]; // MLFQPolicy: the ready threads at each
+				// level, instead of readyList
+    long long sliceStart;	// when the running thread was dispatched
+    long long nextBoost;	// when all threads next go to the top
 };
 
 #endif // SCHEDULER_H
@@ -10,6 +10,7 @@
  *	    SUN SPARC
  *	    HP PA-RISC
  *	    Intel 386
+ *	    x86-64
  *
  * We define two routines for each architecture:
  *
@@ -120,3 +121,65 @@ SWITCH:
         ret
 
 #endif
+
+#ifdef HOST_x86_64
+
+        .text
+        .align  16
+
+        .globl  ThreadRoot
+
+/* void ThreadRoot( void )
+**
+** expects the following registers to be initialized:
+**      r15     points to startup function (interrupt enable)
+**      r13     contains inital argument to thread function
+**      r12     points to thread function
+**      r14     point to Thread::Finish()
+**
+** It is entered by the "ret" at the end of SWITCH, so the stack is
+** aligned as at the start of any function.
+*/
+ThreadRoot:
+        pushq   %rbp
+        movq    %rsp,%rbp
+        call    *StartupPC
+        movq    InitialArg,%rdi
+        call    *InitialPC
+        call    *WhenDonePC
+
+        # NOT REACHED
+        movq    %rbp,%rsp
+        popq    %rbp
+        ret
+
+/* void SWITCH( thread *t1, thread *t2 )
+**
+** on entry, t1 is in rdi, t2 in rsi, and the return address is on the
+** stack; only the callee-saved registers need to be saved in t1, and
+** loaded from t2.  The "ret" then returns to wherever t2 called SWITCH
+** from (or, for a new thread, to ThreadRoot, which StackAllocate left
+** on its stack).
+*/
+        .globl  SWITCH
+SWITCH:
+        movq    %rsp,_RSP(%rdi)         # save registers
+        movq    %rbx,_RBX(%rdi)
+        movq    %rbp,_RBP(%rdi)
+        movq    %r12,_R12(%rdi)
+        movq    %r13,_R13(%rdi)
+        movq    %r14,_R14(%rdi)
+        movq    %r15,_R15(%rdi)
+
+        movq    _RSP(%rsi),%rsp         # restore registers
+        movq    _RBX(%rsi),%rbx
+        movq    _RBP(%rsi),%rbp
+        movq    _R12(%rsi),%r12
+        movq    _R13(%rsi),%r13
+        movq    _R14(%rsi),%r14
+        movq    _R15(%rsi),%r15
+        ret
+
+        .section .note.GNU-stack,"",@progbits   # no executable stack
+
+#endif // HOST_x86_64
@@ -37,7 +37,7 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List;
+    queue = new ThreadList;
 }
 
 //----------------------------------------------------------------------
@@ -67,7 +67,7 @@ Semaphore::P()
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
     
     while (value == 0) { 			// semaphore not available
-	queue->Append((void *)currentThread);	// so go to sleep
+	queue->Append(currentThread);	// so go to sleep
 	currentThread->Sleep();
     } 
     value--; 					// semaphore available, 
@@ -90,13 +90,66 @@ Semaphore::V()
     Thread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    thread = (Thread *)queue->Remove();
+    thread = queue->Remove();
     if (thread != NULL)	   // make thread ready, consuming the V immediately
 	scheduler->ReadyToRun(thread);
-    value++;
+    if ((thread == NULL) || !thread->HasContinuation())
+	value++;	   // a thread waiting without its stack won't check
+			   // the value again, so it is just handed the V
     (void) interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Semaphore::P
+// 	Like P(), but if the semaphore isn't available, the thread gives
+//	up its stack while it waits, and never returns: V hands it the
+//	semaphore, and it starts over in (*then)(arg).
+//
+//	"then" is the procedure to continue in, after waiting.
+//	"arg" is a single argument to be passed to the procedure.
+//----------------------------------------------------------------------
+
+void
+Semaphore::P(VoidFunctionPtr then, _int arg)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (value == 0) {				// semaphore not available
+	queue->Append(currentThread);	// so go to sleep, without
+	currentThread->Block(then, arg);	// the stack
+    }
+    value--;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Semaphore::TryP
+// 	Decrement the semaphore if its value is > 0, and return TRUE;
+//	otherwise, return FALSE, rather than waiting.
+//----------------------------------------------------------------------
+
+bool
+Semaphore::TryP()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    bool available = (value > 0);
+
+    if (available)
+	value--;
+    (void) interrupt->SetLevel(oldLevel);
+    return available;
+}
+
+// What a thread that gave up its stack in Lock::Acquire or
+// Condition::Wait does when it starts over: hold "lock", and then
+// continue in (*then)(arg).
+class LockWaiter {
+  public:
+    Lock *lock;
+    VoidFunctionPtr then;
+    _int arg;
+};
+
 
 //----------------------------------------------------------------------
 // Lock::Lock
@@ -139,6 +192,50 @@ void Lock::Acquire()
     (void) interrupt->SetLevel(oldLevel); // re-enable interrupts
 }
 
+//----------------------------------------------------------------------
+// Lock::Acquire
+//      Like Acquire(), but if the lock is busy, the thread gives up its
+//      stack while it waits, and never returns: Release hands it the
+//      lock, and it starts over in (*then)(arg).
+//
+//	"then" is the procedure to continue in, after waiting.
+//	"arg" is a single argument to be passed to the procedure.
+//----------------------------------------------------------------------
+void Lock::Acquire(VoidFunctionPtr then, _int arg)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (!lock->TryP()) {                  // busy, so wait without a stack
+	LockWaiter *waiter = new LockWaiter;
+
+	waiter->lock = this;
+	waiter->then = then;
+	waiter->arg = arg;
+	lock->P(Acquired, (_int) waiter);  // doesn't return
+    }
+    owner = currentThread;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::Acquired
+//      Where a thread that waited without a stack in Acquire starts
+//      over, once the semaphore has been handed to it: become the
+//      owner, and carry on.
+//
+//	"waiter" is the LockWaiter the thread left.
+//----------------------------------------------------------------------
+void Lock::Acquired(_int waiter)
+{
+    LockWaiter *w = (LockWaiter *) waiter;
+    VoidFunctionPtr then = w->then;
+    _int arg = w->arg;
+
+    w->lock->owner = currentThread;
+    delete w;
+    (*then)(arg);
+}
+
 //----------------------------------------------------------------------
 // Lock::Release
 //      Set the lock to be free (i.e. vanquish the semaphore).  Check
@@ -179,7 +276,7 @@ bool Lock::isHeldByCurrentThread()
 Condition::Condition(char* debugName) 
 { 
     name = debugName;
-    queue = new List;
+    queue = new ThreadList;
     lock = NULL;
 }
 
@@ -219,6 +316,54 @@ void Condition::Wait(Lock* conditionLock)
     (void) interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Condition::Wait
+//
+//      Like Wait(), but the thread gives up its stack while it waits,
+//      and never returns: once signalled, it starts over, re-acquires
+//      the lock (again without its stack, if it has to wait), and
+//      continues in (*then)(arg).
+//
+//	"then" is the procedure to continue in, after waiting.
+//	"arg" is a single argument to be passed to the procedure.
+//----------------------------------------------------------------------
+void Condition::Wait(Lock* conditionLock, VoidFunctionPtr then, _int arg)
+{
+    LockWaiter *waiter = new LockWaiter;
+
+    (void) interrupt->SetLevel(IntOff);
+    ASSERT(conditionLock->isHeldByCurrentThread());  // check pre-condition
+    if(queue->IsEmpty()) {
+	lock = conditionLock;  // helps to enforce pre-condition
+    } 
+    ASSERT(lock == conditionLock); // another pre-condition
+    queue->Append(currentThread);  // add this thread to the waiting list
+    conditionLock->Release();      // release the lock
+    waiter->lock = conditionLock;
+    waiter->then = then;
+    waiter->arg = arg;
+    currentThread->Block(Signalled, (_int) waiter); // doesn't return
+}
+
+//----------------------------------------------------------------------
+// Condition::Signalled
+//      Where a thread that waited without a stack in Wait starts over,
+//      once signalled: re-acquire the lock, and carry on.
+//
+//	"waiter" is the LockWaiter the thread left.
+//----------------------------------------------------------------------
+void Condition::Signalled(_int waiter)
+{
+    LockWaiter *w = (LockWaiter *) waiter;
+    Lock *conditionLock = w->lock;
+    VoidFunctionPtr then = w->then;
+    _int arg = w->arg;
+
+    delete w;
+    conditionLock->Acquire(then, arg);	// returns if it didn't wait
+    (*then)(arg);
+}
+
 //----------------------------------------------------------------------
 // Condition::Signal
 //      Wake up a thread, if there are any waiting on the condition.
@@ -234,7 +379,7 @@ void Condition::Signal(Lock* conditionLock)
     ASSERT(conditionLock->isHeldByCurrentThread());
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
-	nextThread = (Thread *)queue->Remove();
+	nextThread = queue->Remove();
 	scheduler->ReadyToRun(nextThread);      // wake up the thread
     } 
     (void) interrupt->SetLevel(oldLevel);
@@ -255,7 +400,7 @@ void Condition::Broadcast(Lock* conditionLock)
     ASSERT(conditionLock->isHeldByCurrentThread());
     if(!queue->IsEmpty()) {
 	ASSERT(lock == conditionLock);
-	while(nextThread = (Thread *)queue->Remove()) {
+	while ((nextThread = queue->Remove()) != NULL) {
 	    scheduler->ReadyToRun(nextThread);  // wake up the thread
 	}
     } 
@@ -10,6 +10,12 @@
 //	Note that all the synchronization objects take a "name" as
 //	part of the initialization.  This is solely for debugging purposes.
 //
+//	Each way of waiting also comes in a version for threads that give
+//	up their stacks while they wait (see Thread::Block): it is given a
+//	continuation, "then" and "arg", and if it has to wait, it never
+//	returns; the thread starts over in (*then)(arg) once it is done
+//	waiting.  If it doesn't have to wait, it returns as usual.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // synch.h -- synchronization primitives.  
@@ -45,11 +51,15 @@ class Semaphore {
     
     void P();	 // these are the only operations on a semaphore
     void V();	 // they are both *atomic*
+
+    void P(VoidFunctionPtr then, _int arg);
+				// P, without the stack if it has to wait
+    bool TryP();		// P, only if it needn't wait; TRUE if so
     
   private:
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
-    List *queue;       // threads waiting in P() for the value to be > 0
+    ThreadList *queue; // threads waiting in P() for the value to be > 0
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -73,6 +83,10 @@ class Lock {
     void Acquire(); // these are the only operations on a lock
     void Release(); // they are both *atomic*
 
+    void Acquire(VoidFunctionPtr then, _int arg);
+				// Acquire, without the stack if it has
+				// to wait
+
     bool isHeldByCurrentThread();	// true if the current thread
 					// holds this lock.  Useful for
 					// checking in Release, and in
@@ -82,6 +96,9 @@ class Lock {
     char* name;				// for debugging
     Thread *owner;                      // remember who acquired the lock
     Semaphore *lock;                    // use semaphore for the actual lock
+
+    static void Acquired(_int waiter);	// continuation of Acquire, for
+					// a thread that had to wait
 };
 
 // The following class defines a "condition variable".  A condition
@@ -131,10 +148,17 @@ class Condition {
     void Broadcast(Lock *conditionLock);// the currentThread for all of 
 					// these operations
 
+    void Wait(Lock *conditionLock, VoidFunctionPtr then, _int arg);
+					// Wait, without the stack; never
+					// returns, but starts over in
+					// (*then)(arg), holding the lock
+
   private:
     char* name;
-    List* queue;  // threads waiting on the condition
+    ThreadList* queue; // threads waiting on the condition
     Lock* lock;   // debugging aid:  used to check correctness of
                   // arguments to Wait, Signal and Broacast
+
+    static void Signalled(_int waiter);	// continuation of Wait
 };
 #endif // SYNCH_H
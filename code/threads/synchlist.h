@@ -39,4 +39,43 @@ class SynchList {
     Condition *listEmpty;	// wait in Remove if the list is empty
 };
 
+// The following class defines a synchronized intrusive list (see
+// list.h): the same as a SynchList, but for items that carry their
+// own link, so that passing one through the list doesn't allocate.
+
+template <class T, ListLink<T> T::*link>
+class SynchIntrusiveList {
+  public:
+    SynchIntrusiveList() {	// initialize a synchronized list
+	lock = new Lock("list lock");
+	listEmpty = new Condition("list empty cond");
+    }
+    ~SynchIntrusiveList() {	// de-allocate a synchronized list
+	delete lock;
+	delete listEmpty;
+    }
+
+    void Append(T *item) {	// append item to the end of the list,
+	lock->Acquire();	// and wake up any thread waiting in remove
+	list.Append(item);
+	listEmpty->Signal(lock);
+	lock->Release();
+    }
+    T *Remove() {		// remove the first item from the front of
+	T *item;		// the list, waiting if the list is empty
+
+	lock->Acquire();
+	while (list.IsEmpty())
+	    listEmpty->Wait(lock);
+	item = list.Remove();
+	lock->Release();
+	return item;
+    }
+
+  private:
+    IntrusiveList<T, link> list; // the unsynchronized list
+    Lock *lock;			// enforce mutual exclusive access to the list
+    Condition *listEmpty;	// wait in Remove if the list is empty
+};
+
 #endif // SYNCHLIST_H
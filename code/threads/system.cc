@@ -30,7 +30,7 @@ SynchDisk *synchDisk;
 
 #ifdef USER_PROGRAM // requires either FILESYS or FILESYS_STUB
 Machine *machine;   // user program memory and registers
-BitMap *bitmap = new BitMap(NumPhysPages);
+BitMap *bitmap;     // free physical pages
 #endif
 
 #ifdef NETWORK
@@ -56,7 +56,11 @@ extern void Cleanup();
 //	which is what we wanted to context switch), we set a flag
 //	so that once the interrupt handler is done, it will appear as
 //	if the interrupted thread called Yield at the point it is
-//	was interrupted.
+//	was interrupted.  The scheduler decides whether a switch is due
+//	(with the multilevel feedback queue, it may not be).
+//
+//	If user programs are being profiled by sampling, this is also
+//	where the samples are taken.
 //
 //	"dummy" is because every interrupt handler takes one argument,
 //		whether it needs it or not.
@@ -64,10 +68,34 @@ extern void Cleanup();
 static void
 TimerInterruptHandler(_int dummy)
 {
-    if (interrupt->getStatus() != IdleMode)
+#ifdef USER_PROGRAM
+    if ((machine != NULL) && (machine->profiler != NULL) &&
+        machine->profiler->IsSampling() &&
+        (interrupt->getStatus() == UserMode))
+        machine->profiler->Sample(machine->ReadRegister(PCReg));
+#endif
+    if ((interrupt->getStatus() != IdleMode) && scheduler->TimerTick())
         interrupt->YieldOnReturn();
 }
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// ParsePolicy
+// 	Return the TLB or cache replacement policy named "name": one of
+//	"lru", "fifo", or "random".
+//----------------------------------------------------------------------
+static ReplacePolicy
+ParsePolicy(char *name)
+{
+    if (!strcmp(name, "fifo"))
+        return FIFOReplace;
+    if (!strcmp(name, "random"))
+        return RandomReplace;
+    ASSERT(!strcmp(name, "lru"));
+    return LRUReplace;
+}
+#endif
+
 //----------------------------------------------------------------------
 // Initialize
 // 	Initialize Nachos global data structures.  Interpret command
@@ -83,9 +111,30 @@ void Initialize(int argc, char **argv)
     int argCount;
     char *debugArgs = "";
     bool randomYield = FALSE;
+    bool polledIO = FALSE;
+    bool tickless = FALSE;
+    bool timeSlice = FALSE;      // run the timer for a -sched policy
+    SchedPolicy policy = FIFOPolicy;
+    char *statsFile = NULL;      // where to export the statistics
+    bool statsJSON = TRUE;       // as JSON, or else CSV
+    int statsInterval = 0;       // every so many ticks, or only at halt
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE; // single step user program
+    ExecMode execMode = InterpretMode; // how to run user code
+    int physPages = DefaultPhysPages;  // size of physical memory
+    int tlbEntries = DefaultTLBSize;   // size of the TLB
+    int tlbWays = 0;                   // its associativity, 0 for full
+    ReplacePolicy tlbPolicy = LRUReplace; // its replacement policy
+    bool tlbWalk = FALSE;              // refill it from the page table
+    PageTableFormat ptFormat = LinearTable; // page table format
+    int cacheRows[NumCacheLevels] = {0, 0, 0}; // cache shapes; no
+    int cacheAssoc[NumCacheLevels];    // rows means not simulated
+    int cacheLine[NumCacheLevels];
+    ReplacePolicy cachePolicy[NumCacheLevels];
+    bool profCount = FALSE;            // count user instructions
+    bool profSample = FALSE;           // sample the user PC
+    char *profSymbols = NULL;          // symbol table for the profile
     bzero(ThreadMap, 128);
 #endif
 #ifdef FILESYS_NEEDED
@@ -122,9 +171,107 @@ void Initialize(int argc, char **argv)
             randomYield = TRUE;
             argCount = 2;
         }
+        else if (!strcmp(*argv, "-pollio"))
+            polledIO = TRUE; // deterministic device input
+        else if (!strcmp(*argv, "-tickless"))
+            tickless = TRUE; // time-slice only when needed
+        else if (!strcmp(*argv, "-sched"))
+        {
+            ASSERT(argc > 1);
+            if (!strcmp(*(argv + 1), "mlfq"))
+                policy = MLFQPolicy;
+            else
+                ASSERT(!strcmp(*(argv + 1), "fifo"));
+            timeSlice = TRUE;
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-stackpool"))
+        {
+            ASSERT(argc > 1);
+            SetBoundedArrayPool(atoi(*(argv + 1))); // free stacks to keep
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-stackpaint"))
+            SetStackPainting(TRUE);
+        else if (!strcmp(*argv, "-statsout"))
+        {
+            ASSERT(argc > 3);
+            statsFile = *(argv + 1);
+            statsJSON = !strcmp(*(argv + 2), "json");
+            if (!statsJSON)
+                ASSERT(!strcmp(*(argv + 2), "csv"));
+            statsInterval = atoi(*(argv + 3));
+            argCount = 4;
+        }
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s"))
             debugUserProg = TRUE;
+        else if (!strcmp(*argv, "-bb"))
+            execMode = BlockMode;
+        else if (!strcmp(*argv, "-jit"))
+            execMode = CompileMode;
+        else if (!strcmp(*argv, "-jd"))
+            execMode = CompareMode;
+        else if (!strcmp(*argv, "-mem"))
+        {
+            ASSERT(argc > 1);
+            physPages = atoi(*(argv + 1));
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-tlb"))
+        {
+            ASSERT(argc > 1);
+            tlbEntries = atoi(*(argv + 1));
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-tlbways"))
+        {
+            ASSERT(argc > 1);
+            tlbWays = atoi(*(argv + 1));
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-tlbpolicy"))
+        {
+            ASSERT(argc > 1);
+            tlbPolicy = ParsePolicy(*(argv + 1));
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-tlbwalk"))
+            tlbWalk = TRUE;
+        else if (!strcmp(*argv, "-pt"))
+        {
+            ASSERT(argc > 1);
+            if (!strcmp(*(argv + 1), "radix"))
+                ptFormat = RadixTable;
+            else if (!strcmp(*(argv + 1), "inverted"))
+                ptFormat = InvertedTable;
+            else
+                ASSERT(!strcmp(*(argv + 1), "linear"));
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-l1i") || !strcmp(*argv, "-l1d") ||
+                 !strcmp(*argv, "-l2"))
+        {
+            int level = !strcmp(*argv, "-l1i") ? L1ICache :
+                        !strcmp(*argv, "-l1d") ? L1DCache : L2Cache;
+
+            ASSERT(argc > 4);
+            cacheRows[level] = atoi(*(argv + 1));
+            cacheAssoc[level] = atoi(*(argv + 2));
+            cacheLine[level] = atoi(*(argv + 3));
+            cachePolicy[level] = ParsePolicy(*(argv + 4));
+            argCount = 5;
+        }
+        else if (!strcmp(*argv, "-prof"))
+            profCount = TRUE;
+        else if (!strcmp(*argv, "-profsample"))
+            profSample = TRUE;
+        else if (!strcmp(*argv, "-profsyms"))
+        {
+            ASSERT(argc > 1);
+            profSymbols = *(argv + 1);
+            argCount = 2;
+        }
 #endif
 #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f"))
@@ -154,10 +301,24 @@ void Initialize(int argc, char **argv)
 
     DebugInit(debugArgs);        // initialize DEBUG messages
     stats = new Statistics();    // collect statistics
+    if (statsFile != NULL)
+        stats->StartExport(statsFile, statsJSON, statsInterval);
     interrupt = new Interrupt;   // start up interrupt handling
+    interrupt->SetPolledIO(polledIO);
     scheduler = new Scheduler(); // initialize the ready queue
     if (randomYield)             // start the timer (if needed)
         timer = new Timer(TimerInterruptHandler, 0, randomYield);
+    else if (timeSlice)          // fixed time slices for the scheduler
+        timer = new Timer(TimerInterruptHandler, 0, FALSE);
+#ifdef USER_PROGRAM
+    else if (profSample)         // the profiler samples on timer ticks
+        timer = new Timer(TimerInterruptHandler, 0, FALSE);
+    if (profSample)              // which must then keep coming
+        tickless = FALSE;
+#endif
+    scheduler->SetPolicy(policy);
+    if (tickless && (timer != NULL))
+        scheduler->SetTickless(TRUE);
 
     threadToBeDestroyed = NULL;
 
@@ -171,7 +332,29 @@ void Initialize(int argc, char **argv)
     CallOnUserAbort(Cleanup); // if user hits ctl-C
 
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg); // this must come first
+    machine = new Machine(debugUserProg, execMode, physPages, tlbEntries,
+                          tlbWays, tlbPolicy, tlbWalk); // this must come first
+    bitmap = new BitMap(machine->numPhysPages);
+    machine->pageTableFormat = ptFormat;
+    if (ptFormat == InvertedTable)
+        machine->invertedTable = new InvertedPageTable(machine->numPhysPages);
+    if (cacheRows[L2Cache] > 0)
+        machine->cache[L2Cache] = new Cache(L2Cache, cacheRows[L2Cache],
+            cacheAssoc[L2Cache], cacheLine[L2Cache], cachePolicy[L2Cache],
+            MemoryTime, NULL);
+    for (int level = L1ICache; level <= L1DCache; level++)
+        if (cacheRows[level] > 0)
+            machine->cache[level] = new Cache((CacheLevel) level,
+                cacheRows[level], cacheAssoc[level], cacheLine[level],
+                cachePolicy[level],
+                (machine->cache[L2Cache] != NULL) ? L2CacheTime : MemoryTime,
+                machine->cache[L2Cache]);
+    if (profCount || profSample)
+    {
+        machine->profiler = new Profiler(profCount, profSample);
+        if (profSymbols != NULL)
+            machine->profiler->LoadSymbols(profSymbols);
+    }
 #endif
 
 #ifdef FILESYS
@@ -199,6 +382,8 @@ void Cleanup()
 #endif
 
 #ifdef USER_PROGRAM
+    if (machine->profiler != NULL)
+        machine->profiler->Report();
     delete machine;
 #endif
 
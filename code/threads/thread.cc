@@ -23,6 +23,26 @@
 #define STACK_FENCEPOST 0xdeadbeef	// this is put at the top of the
 					// execution stack, for detecting 
 					// stack overflows
+#define STACK_PAINT	((int) 0xfeedface) // the rest of a painted stack is
+					// filled with this, until it is used
+
+static bool paintStacks = FALSE;	// paint new stacks?
+
+//----------------------------------------------------------------------
+// SetStackPainting
+// 	Turn stack painting on or off.  When it is on, each new stack is
+//	filled with STACK_PAINT, so that we can tell how much of it a
+//	thread has used by looking for the deepest word that doesn't
+//	hold STACK_PAINT any more; each thread reports its peak use
+//	when it finishes.  This costs a pass over each stack when it is
+//	allocated, so it is off by default.
+//----------------------------------------------------------------------
+
+void
+SetStackPainting(bool on)
+{
+    paintStacks = on;
+}
 
 //----------------------------------------------------------------------
 // Thread::Thread
@@ -34,10 +54,42 @@
 
 Thread::Thread(char* threadName)
 {
+    Init(threadName, StackSize);
+}
+
+//----------------------------------------------------------------------
+// Thread::Thread
+// 	Initialize a thread control block, for a thread whose stack is
+//	to be a different size than StackSize -- smaller, for a thread
+//	known not to need much (see SetStackPainting), to save memory
+//	when there are many of them.
+//
+//	"threadName" is an arbitrary string, useful for debugging.
+//	"stackWords" is the size of the thread's stack, in words.
+//----------------------------------------------------------------------
+
+Thread::Thread(char* threadName, int stackWords)
+{
+    Init(threadName, stackWords);
+}
+
+//----------------------------------------------------------------------
+// Thread::Init
+// 	Fill in a new thread control block; shared by the constructors.
+//----------------------------------------------------------------------
+
+void
+Thread::Init(char* threadName, int stackWords)
+{
+    ASSERT(stackWords > 0);
     name = threadName;
     stackTop = NULL;
     stack = NULL;
+    stackSize = stackWords;
+    stackPeak = 0;
     status = JUST_CREATED;
+    level = 0;
+    continuation = NULL;
 #ifdef USER_PROGRAM
     space = NULL;
 #endif
@@ -61,7 +113,7 @@ Thread::~Thread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-		DeallocBoundedArray((char *) stack, StackSize * sizeof(_int));
+		DeallocBoundedArray((char *) stack, stackSize * sizeof(_int));
 }
 
 //----------------------------------------------------------------------
@@ -87,7 +139,7 @@ Thread::~Thread()
 void 
 Thread::Fork(VoidFunctionPtr func, _int arg)
 {
-#ifdef HOST_ALPHA
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
     DEBUG('t', "Forking thread \"%s\" with func = 0x%lx, arg = %ld\n",
 	  name, (long) func, arg);
 #else
@@ -103,6 +155,27 @@ Thread::Fork(VoidFunctionPtr func, _int arg)
     (void) interrupt->SetLevel(oldLevel);
 }    
 
+//----------------------------------------------------------------------
+// Thread::ForkContinuation
+// 	Like Fork, but the thread is only given a stack when it is first
+//	dispatched, so that a great many threads can be forked, and wait
+//	to run, cheaply.
+//
+//	"func" is the procedure to run concurrently.
+//	"arg" is a single argument to be passed to the procedure.
+//----------------------------------------------------------------------
+
+void
+Thread::ForkContinuation(VoidFunctionPtr func, _int arg)
+{
+    continuation = func;
+    continuationArg = arg;
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    scheduler->ReadyToRun(this);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
 //----------------------------------------------------------------------
 // Thread::CheckOverflow
 // 	Check a thread's stack to see if it has overrun the space
@@ -123,12 +196,44 @@ Thread::CheckOverflow()
 {
     if (stack != NULL)
 #ifdef HOST_SNAKE			// Stacks grow upward on the Snakes
-	ASSERT((unsigned int)stack[StackSize - 1] == STACK_FENCEPOST);
+	ASSERT((unsigned int)stack[StackInts() - 1] == STACK_FENCEPOST);
 #else
 	ASSERT((unsigned int)*stack == STACK_FENCEPOST);
 #endif
 }
 
+//----------------------------------------------------------------------
+// Thread::MeasureStack
+// 	If stacks are painted, find the deepest word of this thread's
+//	stack that it has written, and remember in "stackPeak" the most
+//	stack (in bytes) the thread has used so far.  A thread that
+//	blocks without its stack gets a fresh one when it runs again,
+//	so this is called for each stack it had.
+//
+//	Like CheckOverflow, this can be fooled: a word the thread wrote
+//	that happens to hold STACK_PAINT is counted as unused.
+//----------------------------------------------------------------------
+
+void
+Thread::MeasureStack()
+{
+    int used, i;
+
+    if (!paintStacks || (stack == NULL))
+	return;
+#ifdef HOST_SNAKE			// Stacks grow upward on the Snakes
+    for (i = StackInts() - 2; (i > 0) && (stack[i] == STACK_PAINT); i--)
+	;
+    used = (i + 1) * sizeof(int);
+#else
+    for (i = 1; (i < StackInts()) && (stack[i] == STACK_PAINT); i++)
+	;
+    used = (StackInts() - i) * sizeof(int);
+#endif
+    if (used > stackPeak)
+	stackPeak = used;
+}
+
 //----------------------------------------------------------------------
 // Thread::Finish
 // 	Called by ThreadRoot when a thread is done executing the 
@@ -152,6 +257,12 @@ Thread::Finish ()
     ASSERT(this == currentThread);
     
     DEBUG('t', "Finishing thread \"%s\"\n", getName());
+
+    if (paintStacks && (stack != NULL)) {
+	MeasureStack();
+	printf("Thread \"%s\" used %d of its %d bytes of stack\n", name,
+	       stackPeak, (int) (stackSize * sizeof(_int)));
+    }
     
     threadToBeDestroyed = currentThread;
     Sleep();					// invokes SWITCH
@@ -199,7 +310,8 @@ Thread::Yield ()
 // 	Relinquish the CPU, because the current thread is blocked
 //	waiting on a synchronization variable (Semaphore, Lock, or Condition).
 //	Eventually, some thread will wake this thread up, and put it
-//	back on the ready queue, so that it can be re-scheduled.
+//	back on the ready queue, so that it can be re-scheduled.  The
+//	scheduler is told, since it favors threads that block.
 //
 //	NOTE: if there are no threads on the ready queue, that means
 //	we have no thread to run.  "Interrupt::Idle" is called
@@ -224,22 +336,125 @@ Thread::Sleep ()
     DEBUG('t', "Sleeping thread \"%s\"\n", getName());
 
     status = BLOCKED;
+    scheduler->Blocked(this);
     while ((nextThread = scheduler->FindNextToRun()) == NULL)
 	interrupt->Idle();	// no one to run, wait for an interrupt
         
     scheduler->Run(nextThread); // returns when we've been signalled
 }
 
+// Where Block saves the state of the stack it abandons, when it starts
+// a thread over without switching to another thread; never resumed.
+static Thread leftBehind("left behind");
+
 //----------------------------------------------------------------------
-// ThreadFinish, InterruptEnable, ThreadPrint
+// Thread::Block
+// 	Like Sleep, but the thread gives up its stack while it waits, so
+//	that all it takes up is its Thread object.  When it is woken, it
+//	starts over in (*func)(arg), on a new stack, with interrupts
+//	enabled; when that returns, the thread finishes.  So Block never
+//	returns.
+//
+//	Scheduler::Run frees the stack once it has switched off it.  If
+//	the thread is woken before any other thread runs (the CPU was
+//	idle), Sleep returns here instead; we still start over on a new
+//	stack, rather than call (*func)(arg) on top of Block and Sleep,
+//	or a thread that blocks again each time it is woken would pile
+//	up another set of their frames per wakeup.
+//
+//	NOTE: as with Sleep, interrupts must already be disabled.
+//
+//	"func" is the procedure to start over in.
+//	"arg" is a single argument to be passed to the procedure.
+//----------------------------------------------------------------------
+
+void
+Thread::Block(VoidFunctionPtr func, _int arg)
+{
+    ASSERT(stack != NULL);		// not the main thread
+    CheckOverflow();
+    continuation = func;
+    continuationArg = arg;
+    Sleep();				// returns only if no one else ran
+
+    DropStack();			// so start over as if they had:
+    StartOver();			// SwitchDone, in ThreadBegin, frees
+    SWITCH(&leftBehind, this);		// the stack we leave
+    ASSERT(FALSE);			// not reached
+}
+
+//----------------------------------------------------------------------
+// Thread::DropStack
+// 	If the thread has blocked without its stack, let it go: it is
+//	freed by SwitchDone, once we have switched to another thread.
+//----------------------------------------------------------------------
+
+static int *stackToBeFreed = NULL;	// the stack DropStack let go of
+static int stackToBeFreedSize;		// and its size, in bytes
+
+void
+Thread::DropStack()
+{
+    if ((continuation != NULL) && (stack != NULL)) {
+	ASSERT(stackToBeFreed == NULL);
+	MeasureStack();			// its next stack starts out clean
+	stackToBeFreed = stack;
+	stackToBeFreedSize = stackSize * sizeof(_int);
+	stack = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// Thread::StartOver
+// 	If the thread has no stack because it blocked without one (or
+//	because it was forked with ForkContinuation), give it a new one,
+//	so that switching to it runs its continuation.  Stacks are
+//	recycled (see AllocBoundedArray), so this is cheap.
+//----------------------------------------------------------------------
+
+void
+Thread::StartOver()
+{
+    if ((continuation != NULL) && (stack == NULL)) {
+	StackAllocate(continuation, continuationArg);
+	continuation = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// SwitchDone
+// 	Called on the new thread's stack, once SWITCH has switched to it
+//	(from Scheduler::Run, or, for a thread that is just starting, from
+//	ThreadRoot): delete the thread that finished, and free the stack
+//	of the one that blocked without it, if we switched from either.
+//	Neither could be done before, because we were still running on
+//	the old thread's stack!
+//----------------------------------------------------------------------
+
+void
+SwitchDone()
+{
+    if (threadToBeDestroyed != NULL) {
+        delete threadToBeDestroyed;
+	threadToBeDestroyed = NULL;
+    }
+    if (stackToBeFreed != NULL) {
+	DeallocBoundedArray((char *) stackToBeFreed, stackToBeFreedSize);
+	stackToBeFreed = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// ThreadFinish, ThreadBegin, ThreadPrint
 //	Dummy functions because C++ does not allow a pointer to a member
 //	function.  So in order to do this, we create a dummy C function
 //	(which we can pass a pointer to), that then simply calls the 
-//	member function.
+//	member function.  ThreadBegin is the first thing a new thread
+//	does: clean up after the old one, and enable interrupts.
 //----------------------------------------------------------------------
 
 static void ThreadFinish()    { currentThread->Finish(); }
-static void InterruptEnable() { interrupt->Enable(); }
+static void ThreadBegin()     { SwitchDone(); interrupt->Enable(); }
 void ThreadPrint(_int arg){ Thread *t = (Thread *)arg; t->Print(); }
 
 //----------------------------------------------------------------------
@@ -257,19 +472,27 @@ void ThreadPrint(_int arg){ Thread *t = (Thread *)arg; t->Print(); }
 void
 Thread::StackAllocate (VoidFunctionPtr func, _int arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(_int));
+    bool pooled;
+
+    stack = (int *) AllocBoundedArray(stackSize * sizeof(_int), &pooled);
+    stats->numStacksAllocated++;
+    if (pooled)
+	stats->numStacksPooled++;		// reused, not mapped
+    if (paintStacks)
+	for (int i = 0; i < StackInts(); i++)
+	    stack[i] = STACK_PAINT;
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
     stackTop = stack + 16;	// HP requires 64-byte frame marker
-    stack[StackSize - 1] = STACK_FENCEPOST;
+    stack[StackInts() - 1] = STACK_FENCEPOST;
 #else
     // i386 & MIPS & SPARC & ALPHA stack works from high addresses to low addresses
 #ifdef HOST_SPARC
     // SPARC stack must contains at least 1 activation record to start with.
-    stackTop = stack + StackSize - 96;
+    stackTop = stack + StackInts() - 96;
 #else  // HOST_MIPS  || HOST_i386 || HOST_ALPHA
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    stackTop = stack + StackInts() - 4;	// -4 to be on the safe side!
 #ifdef HOST_i386
     // the 80386 passes the return address on the stack.  In order for
     // SWITCH() to go to ThreadRoot when we switch to this thread, the
@@ -348,13 +571,22 @@ Thread::StackAllocate (VoidFunctionPtr func, _int arg)
 
 
 
+#endif
+#ifdef HOST_x86_64
+    // SWITCH for x86-64 doesn't save the PC: it "returns" to a new
+    // thread through the return address on its stack, so leave the
+    // starting address of ThreadRoot there.  The slot is 16-byte
+    // aligned, so that ThreadRoot starts with the stack aligned the
+    // way the ABI requires.
+    stackTop = (int *) ((char *) stackTop - 16);
+    *(_int *) stackTop = (_int) ThreadRoot;
 #endif
 #endif  // HOST_SPARC
     *stack = STACK_FENCEPOST;
 #endif  // HOST_SNAKE
     
     machineState[PCState] = (_int) ThreadRoot;
-    machineState[StartupPCState] = (_int) InterruptEnable;
+    machineState[StartupPCState] = (_int) ThreadBegin;
     machineState[InitialPCState] = (_int) func;
     machineState[InitialArgState] = arg;
     machineState[WhenDonePCState] = (_int) ThreadFinish;
@@ -24,7 +24,9 @@
 //	that your thread stacks are too small.)
 //	
 //	One thing to try if you find yourself with seg faults is to
-//	increase the size of thread stack -- ThreadStackSize.
+//	increase the size of thread stack -- StackSize, or the size
+//	given to the Thread constructor.  With -stackpaint, each thread
+//	reports how much of its stack it used, when it finishes.
 //
 //  	In this interface, forking a thread takes two steps.
 //	We must first allocate a data structure for it: "t = new Thread".
@@ -39,6 +41,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "list.h"
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -52,7 +55,8 @@
 #define MachineStateSize 18 
 
 
-// Size of the thread's private execution stack.
+// Size of the thread's private execution stack, unless another size is
+// given when it is created.
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 #define StackSize	(sizeof(_int) * 1024)	// in words
 
@@ -63,6 +67,13 @@ enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 // external function, dummy routine whose sole job is to call Thread::Print
 extern void ThreadPrint(_int arg);	 
 
+// external function, to clean up after the thread we just switched from
+extern void SwitchDone();
+
+// external function, to fill new stacks with a pattern, so that each
+// thread's peak stack use can be reported when it finishes
+extern void SetStackPainting(bool on);
+
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
 //
@@ -73,6 +84,12 @@ extern void ThreadPrint(_int arg);
 //    
 //  Some threads also belong to a user address space; threads
 //  that only run in the kernel have a NULL address space.
+//
+//  A thread can also block without its stack, giving a "continuation"
+//  -- a procedure and its argument -- to start over in once it is
+//  woken, on a new stack; it then costs only its Thread object while
+//  it waits.  Semaphore, Lock and Condition have versions of P, Acquire
+//  and Wait that do this.
 
 class Thread {
   private:
@@ -83,6 +100,9 @@ class Thread {
 
   public:
     Thread(char* debugName);		// initialize a Thread 
+    Thread(char* debugName, int stackWords);
+					// initialize a Thread, with a stack of
+					// "stackWords" words, not StackSize
     ~Thread(); 				// deallocate a Thread
 					// NOTE -- thread being deleted
 					// must not be running when delete 
@@ -96,12 +116,31 @@ class Thread {
     void Sleep();  				// Put the thread to sleep and 
 						// relinquish the processor
     void Finish();  				// The thread is done executing
+
+    void ForkContinuation(VoidFunctionPtr func, _int arg);
+				// Make thread run (*func)(arg), but only
+				// give it a stack once it is dispatched
+    void Block(VoidFunctionPtr func, _int arg);
+				// Sleep without a stack, and start over in
+				// (*func)(arg) when woken; doesn't return
+    bool HasContinuation() { return (continuation != NULL); }
+    void DropStack();		// Give up the stack, if blocked without
+				// one (called by Scheduler::Run)
+    void StartOver();		// Give a thread blocked without a stack
+				// a new one, to run its continuation on
+				// (called by Scheduler::Run)
     
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
     void setStatus(ThreadStatus st) { status = st; }
     char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
+    int getLevel() { return level; }
+    void setLevel(int l) { level = l; }
+
+    ListLink<Thread> queueLink;		// for the one queue the thread can
+					// be on: the ready list, or the
+					// queue of what it is waiting for
 
   private:
     // some of the private data for this class is listed above
@@ -109,12 +148,25 @@ class Thread {
     int* stack; 	 		// Bottom of the stack 
 					// NULL if this is the main thread
 					// (If NULL, don't deallocate stack)
+    int stackSize;			// size of the stack, in words
+    int stackPeak;			// most bytes of it used, as far as
+					// we know (with stack painting)
     ThreadStatus status;		// ready, running or blocked
     char* name;
-
+    int level;				// the scheduler's priority for the
+					// thread, 0 highest (see scheduler.h)
+    VoidFunctionPtr continuation;	// where the thread starts over, if
+					// it blocked without a stack; or NULL
+    _int continuationArg;		// and the argument to pass it
+
+    void Init(char* threadName, int stackWords);
+					// Shared by the constructors
     void StackAllocate(VoidFunctionPtr func, _int arg);
     					// Allocate a stack for thread.
 					// Used internally by Fork()
+    int StackInts() { return stackSize * sizeof(_int) / sizeof(int); }
+					// size of the stack, in "int"s
+    void MeasureStack();		// Update stackPeak, if painting
 
 #ifdef USER_PROGRAM
 // A thread running a user program actually has *two* sets of CPU registers -- 
@@ -131,6 +183,9 @@ class Thread {
 #endif
 };
 
+// A queue of threads, linked through their queueLink (see list.h).
+typedef IntrusiveList<Thread, &Thread::queueLink> ThreadList;
+
 // Magical machine-dependent routines, defined in switch.s
 
 extern "C" {
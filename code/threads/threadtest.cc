@@ -11,6 +11,7 @@
 
 #include "copyright.h"
 #include "system.h"
+#include "synch.h"
 
 //----------------------------------------------------------------------
 // SimpleThread
@@ -49,3 +50,249 @@ ThreadTest()
     SimpleThread(0);
 }
 
+
+//----------------------------------------------------------------------
+// The scheduler benchmark.  An interactive thread waits for keystrokes
+// from a simulated keyboard, and does a little work for each, while
+// BenchHogs CPU-bound threads compute without ever blocking.  What
+// matters for the interactive thread is its response time: how long
+// after each keystroke it gets the CPU.
+//----------------------------------------------------------------------
+
+#define BenchHogs	3	// CPU-bound threads
+#define BenchKeys	100	// keystrokes to time
+#define BenchKeyGap	1000	// mean ticks between keystrokes
+#define BenchWork	5	// interrupt enables (of SystemTick each)
+				// per unit of work
+
+static Semaphore *keyPressed;	// V'ed by the keyboard for each keystroke
+static Semaphore *benchDone;	// V'ed by each thread as it finishes
+static long long keyTime;	// when the last key was pressed
+static int keysLeft;		// keystrokes still to come
+static bool stopHogs;		// the interactive thread is done
+static int hogWork;		// units of work the hogs got done
+static Histogram responses;	// the interactive thread's response times
+
+// Do "units" of work -- that is, let simulated time pass.
+static void
+Work(int units)
+{
+    for (int i = 0; i < units * BenchWork; i++) {
+	interrupt->SetLevel(IntOff);
+	interrupt->SetLevel(IntOn);
+    }
+}
+
+// How long until the next keystroke: BenchKeyGap on average, but
+// random, so that keystrokes don't all arrive at the same point in
+// a time slice.
+static int
+KeyGap()
+{
+    return BenchKeyGap / 2 + Random() % BenchKeyGap;
+}
+
+// The keyboard interrupt handler: a key was pressed.
+static void
+Keystroke(_int dummy)
+{
+    keyTime = stats->totalTicks;
+    keyPressed->V();
+    if (--keysLeft > 0)
+	interrupt->Schedule(Keystroke, 0, KeyGap(), ConsoleReadInt);
+}
+
+static void
+InteractiveThread(_int dummy)
+{
+    for (int i = 0; i < BenchKeys; i++) {
+	keyPressed->P();
+	responses.Record(stats->totalTicks - keyTime);
+	Work(1);
+    }
+    stopHogs = TRUE;
+    benchDone->V();
+}
+
+static void
+HogThread(_int dummy)
+{
+    while (!stopHogs) {
+	Work(1);
+	hogWork++;
+    }
+    benchDone->V();
+}
+
+//----------------------------------------------------------------------
+// SchedulerBenchmark
+// 	Run the interactive thread against the CPU-bound ones, under the
+//	scheduling policy chosen with -sched, and print the response
+//	times, and how much the CPU-bound threads got done meanwhile.
+//----------------------------------------------------------------------
+
+void
+SchedulerBenchmark()
+{
+    long long start = stats->totalTicks;
+    int i;
+
+    if (timer == NULL) {
+	printf("Scheduler benchmark: needs the timer (-sched or -rs)\n");
+	return;
+    }
+    keyPressed = new Semaphore("key pressed", 0);
+    benchDone = new Semaphore("benchmark done", 0);
+    keysLeft = BenchKeys;
+    stopHogs = FALSE;
+    hogWork = 0;
+    responses.Clear();
+
+    for (i = 0; i < BenchHogs; i++)
+	(new Thread("hog"))->Fork(HogThread, 0);
+    (new Thread("interactive"))->Fork(InteractiveThread, 0);
+    interrupt->Schedule(Keystroke, 0, KeyGap(), ConsoleReadInt);
+    for (i = 0; i < BenchHogs + 1; i++)
+	benchDone->P();
+
+    printf("Scheduler benchmark: %d keystrokes, %d CPU-bound threads, "
+	   "%lld ticks\n", BenchKeys, BenchHogs, stats->totalTicks - start);
+    printf("  response time: mean %.1f, p50 %lld, p99 %lld, max %lld ticks\n",
+	   (double) responses.sum / responses.count, responses.Percentile(50),
+	   responses.Percentile(99), responses.max);
+    printf("  CPU-bound work done: %d units\n", hogWork);
+    delete keyPressed;
+    delete benchDone;
+}
+
+//----------------------------------------------------------------------
+// The context switch benchmark.  Two threads ping-pong the CPU, each
+// yielding to the other until "switchesLeft" runs out; the time per
+// switch is mostly Yield, the scheduler and SWITCH.
+//----------------------------------------------------------------------
+
+static int switchesLeft;	// yields still to do, by either thread
+
+static void
+PingPong(_int dummy)
+{
+    while (switchesLeft-- > 0)
+	currentThread->Yield();
+}
+
+//----------------------------------------------------------------------
+// SwitchBenchmark
+// 	Time "switches" context switches between the main thread and a
+//	forked one, on the host clock, and print how long each took.
+//----------------------------------------------------------------------
+
+void
+SwitchBenchmark(int switches)
+{
+    double start, elapsed;
+
+    ASSERT(switches > 0);
+    switchesLeft = switches;
+    (new Thread("ping-pong"))->Fork(PingPong, 0);
+    start = HostSeconds();
+    PingPong(0);
+    elapsed = HostSeconds() - start;
+    currentThread->Yield();		// let the other one finish
+
+    printf("Context switch benchmark: %d switches in %.3f seconds, "
+	   "%.0f ns each\n", switches, elapsed, elapsed * 1e9 / switches);
+}
+
+//----------------------------------------------------------------------
+// The continuation thread test.  Many threads wait at once, without
+// their stacks: first on a semaphore, then, having been let through,
+// for a lock the main thread holds, then, holding it, on a condition.
+// Each step is a separate procedure, since a thread that waits starts
+// over in the next one.
+//----------------------------------------------------------------------
+
+static Semaphore *gate;		// the threads wait here first
+static Lock *mutex;		// then for this
+static Condition *wakeUp;	// then on this, holding "mutex"
+static Semaphore *allThrough;	// V'ed by the last thread to finish
+static int waiting;		// threads still to finish
+static int numThrough;		// threads that got through everything
+
+static void
+Through(_int which)
+{
+    numThrough++;
+    mutex->Release();
+    if (--waiting == 0)
+	allThrough->V();
+}
+
+static void
+Locked(_int which)
+{
+    wakeUp->Wait(mutex, Through, which);
+}
+
+static void
+Passed(_int which)
+{
+    mutex->Acquire(Locked, which);
+    Locked(which);
+}
+
+static void
+Waiter(_int which)
+{
+    gate->P(Passed, which);
+    Passed(which);
+}
+
+//----------------------------------------------------------------------
+// ContinuationTest
+// 	Fork "threads" threads with ForkContinuation, and walk them all
+//	through the semaphore, the lock and the condition, yielding so
+//	that all of them are waiting at each step.  Print how much memory
+//	they took while waiting, and check that they all got through.
+//----------------------------------------------------------------------
+
+void
+ContinuationTest(int threads)
+{
+    long long stacks = stats->numStacksAllocated;
+    long long pooled = stats->numStacksPooled;
+    int i;
+
+    ASSERT(threads > 0);
+    gate = new Semaphore("gate", 0);
+    mutex = new Lock("mutex");
+    wakeUp = new Condition("wake up");
+    allThrough = new Semaphore("all through", 0);
+    waiting = threads;
+    numThrough = 0;
+
+    for (i = 0; i < threads; i++)
+	(new Thread("waiter"))->ForkContinuation(Waiter, i);
+    currentThread->Yield();		// they all wait on "gate"
+    mutex->Acquire();
+    for (i = 0; i < threads; i++)
+	gate->V();
+    currentThread->Yield();		// they all wait for "mutex"
+    mutex->Release();
+    mutex->Acquire();			// once each has had it, and gone on
+					// to wait on "wakeUp"
+    wakeUp->Broadcast(mutex);
+    mutex->Release();
+    allThrough->P();
+
+    printf("Continuation threads: %d waited at once, in %d byte Thread "
+	   "objects (a stack is %d more); %d got through, using %lld stacks, "
+	   "%lld of them from the pool\n", threads, (int) sizeof(Thread),
+	   (int) (StackSize * sizeof(_int)), numThrough,
+	   stats->numStacksAllocated - stacks,
+	   stats->numStacksPooled - pooled);
+    ASSERT(numThrough == threads);
+    delete gate;
+    delete mutex;
+    delete wakeUp;
+    delete allThrough;
+}
@@ -25,8 +25,10 @@
 
 #include "copyright.h"
 
-#ifdef HOST_ALPHA		// Needed because of gcc uses 64 bit pointers and
-#define _int long		// 32 bit integers on the DEC ALPHA architecture.
+#if defined(HOST_ALPHA) || defined(HOST_x86_64)
+#define _int long		// Needed because of gcc uses 64 bit pointers and
+				// 32 bit integers on the DEC ALPHA and
+				// x86-64 (LP64) architectures.
 #else
 #define _int int
 #endif
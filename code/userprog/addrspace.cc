@@ -20,6 +20,8 @@
 #include "addrspace.h"
 #include "noff.h"
 
+static int nextASID = 0;	// ID for the next address space's TLB entries
+
 //----------------------------------------------------------------------
 // SwapHeader
 // 	Do little endian to big endian conversion on the bytes in the 
@@ -62,6 +64,8 @@ AddrSpace::AddrSpace(OpenFile *executable)
     NoffHeader noffH;
     unsigned int i, size;
 
+    asid = nextASID++;
+
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && 
 		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
@@ -69,35 +73,51 @@ AddrSpace::AddrSpace(OpenFile *executable)
     ASSERT(noffH.noffMagic == NOFFMAGIC);
 
 // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
+    pageTable = NULL;
+    sparseTable = NULL;
+    if (machine->pageTableFormat == LinearTable) {
+	size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
 			+ UserStackSize;	// we need to increase the size
 						// to leave room for the stack
-    numPages = divRoundUp(size, PageSize);
-    size = numPages * PageSize;
+	numPages = divRoundUp(size, PageSize);
+	stackPages = 0;
+    } else {				// the stack goes at the top
+	numPages = divRoundUp(noffH.code.size + noffH.initData.size +
+			      noffH.uninitData.size, PageSize);
+	stackPages = divRoundUp(UserStackSize, PageSize);
+    }
+    size = (numPages + stackPages) * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
+    ASSERT(numPages + stackPages <= (unsigned int) machine->numPhysPages);
+						// check we're not trying
 						// to run anything too big --
 						// at least until we have
 						// virtual memory
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
-					numPages, size);
+					numPages + stackPages, size);
 // first, set up the translation 
-    pageTable = new TranslationEntry[numPages];
-    for (i = 0; i < numPages; i++) {
-	pageTable[i].virtualPage = i;	// for now, virtual page # = phys page #
-	pageTable[i].physicalPage = i;
-	pageTable[i].valid = TRUE;
-	pageTable[i].use = FALSE;
-	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
-					// a separate page, we could set its 
+    if (stackPages > 0)
+	MapPages();
+    else {
+	pageTable = new TranslationEntry[numPages];
+	for (i = 0; i < numPages; i++) {
+	    pageTable[i].virtualPage = i;	// for now, virtual page # =
+	    pageTable[i].physicalPage = i;	// phys page #
+	    pageTable[i].valid = TRUE;
+	    pageTable[i].use = FALSE;
+	    pageTable[i].dirty = FALSE;
+	    pageTable[i].readOnly = FALSE;  // if the code segment was entirely
+					// on a separate page, we could set its 
 					// pages to be read-only
+	}
     }
+    Account();
     
 // zero out the entire address space, to zero the unitialized data segment 
 // and the stack segment
     bzero(machine->mainMemory, size);
+    machine->InvalidateDecoded(0, size);
 
 // then, copy in the code and data segments into memory
     if (noffH.code.size > 0) {
@@ -115,6 +135,86 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::MapPages
+// 	Build a radix or inverted page table for the address space: the
+//	code and data pages at the bottom, mapped 1:1 to physical pages
+//	as with the linear table, and the stack pages at the top of the
+//	virtual address space, in the physical pages after them.  Only
+//	the pages actually used take room in the table.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::MapPages()
+{
+    unsigned int i;
+
+    sparseTable = new PageTable(machine->pageTableFormat, asid,
+				machine->invertedTable);
+    for (i = 0; i < numPages; i++)
+	sparseTable->Map(i, i);
+    for (i = 0; i < stackPages; i++)
+	sparseTable->Map(MaxVirtPages - stackPages + i, numPages + i);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Account
+// 	Record the host memory taken by our page table, for the
+//	statistics printed at halt.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Account()
+{
+    int bytes = (sparseTable != NULL) ? sparseTable->Footprint() :
+			numPages * sizeof(TranslationEntry);
+
+    DEBUG('a', "Page table takes %d bytes\n", bytes);
+    stats->numAddrSpaces++;
+    stats->pageTableBytes += bytes;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Re-create an address space from a checkpoint: read back the page
+//	table written by AddrSpace::Checkpoint.  The pages themselves
+//	have already been restored, along with the rest of physical
+//	memory, by Machine::Restore.  The entries go into a page table
+//	of the format now in use; a space saved with its stack at the
+//	top of the address space can't be restored into a linear table.
+//
+//	"checkpoint" is the open host file holding the checkpoint
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(int checkpoint)
+{
+    TranslationEntry entry, *mapped;
+
+    asid = nextASID++;
+    pageTable = NULL;
+    sparseTable = NULL;
+    Read(checkpoint, (char *) &numPages, sizeof(numPages));
+    Read(checkpoint, (char *) &stackPages, sizeof(stackPages));
+    ASSERT(numPages + stackPages <= (unsigned int) machine->numPhysPages);
+    if (machine->pageTableFormat == LinearTable) {
+	ASSERT(stackPages == 0);	// a linear table can't map the hole
+	pageTable = new TranslationEntry[numPages];
+	Read(checkpoint, (char *) pageTable,
+	     numPages * sizeof(TranslationEntry));
+    } else {
+	sparseTable = new PageTable(machine->pageTableFormat, asid,
+				    machine->invertedTable);
+	for (unsigned int i = 0; i < numPages + stackPages; i++) {
+	    Read(checkpoint, (char *) &entry, sizeof(TranslationEntry));
+	    mapped = sparseTable->Map(entry.virtualPage, entry.physicalPage);
+	    mapped->use = entry.use;
+	    mapped->dirty = entry.dirty;
+	    mapped->readOnly = entry.readOnly;
+	}
+    }
+    Account();
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
 // 	Dealloate an address space.  Nothing for now!
@@ -122,7 +222,9 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
 AddrSpace::~AddrSpace()
 {
+   machine->FlushTLB(asid);
    delete [] pageTable;
+   delete sparseTable;
 }
 
 //----------------------------------------------------------------------
@@ -153,8 +255,10 @@ AddrSpace::InitRegisters()
    // Set the stack register to the end of the address space, where we
    // allocated the stack; but subtract off a bit, to make sure we don't
    // accidentally reference off the end!
-    machine->WriteRegister(StackReg, numPages * PageSize - 16);
-    DEBUG('a', "Initializing stack register to %d\n", numPages * PageSize - 16);
+    unsigned int top = (stackPages > 0) ? MaxVirtPages : numPages;
+
+    machine->WriteRegister(StackReg, top * PageSize - 16);
+    DEBUG('a', "Initializing stack register to 0x%x\n", top * PageSize - 16);
 }
 
 //----------------------------------------------------------------------
@@ -168,16 +272,46 @@ AddrSpace::InitRegisters()
 void AddrSpace::SaveState() 
 {}
 
+//----------------------------------------------------------------------
+// AddrSpace::Checkpoint
+// 	Save the address space to the open host file "fd", as part of a
+//	checkpoint: just the size and the page table entries, since the
+//	contents are in physical memory, which the machine saves.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Checkpoint(int fd)
+{
+    unsigned int i;
+
+    WriteFile(fd, (char *) &numPages, sizeof(numPages));
+    WriteFile(fd, (char *) &stackPages, sizeof(stackPages));
+    if (sparseTable == NULL) {
+	WriteFile(fd, (char *) pageTable, numPages * sizeof(TranslationEntry));
+	return;
+    }
+    for (i = 0; i < numPages; i++)
+	WriteFile(fd, (char *) sparseTable->Lookup(i),
+		  sizeof(TranslationEntry));
+    for (i = MaxVirtPages - stackPages; i < MaxVirtPages; i++)
+	WriteFile(fd, (char *) sparseTable->Lookup(i),
+		  sizeof(TranslationEntry));
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::RestoreState
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//	throw away any translations cached for the previous one.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
     machine->pageTable = pageTable;
-    machine->pageTableSize = numPages;
+    machine->pageTableSize = (pageTable != NULL) ? numPages : 0;
+    machine->sparseTable = sparseTable;
+    machine->asid = asid;
+    machine->FlushSoftTLB();
 }
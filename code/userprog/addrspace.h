@@ -23,6 +23,9 @@ class AddrSpace {
     AddrSpace(OpenFile *executable);	// Create an address space,
 					// initializing it with the program
 					// stored in the file "executable"
+    AddrSpace(int checkpoint);		// Re-create an address space saved
+					// by Checkpoint, reading it from
+					// the open host file "checkpoint"
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
@@ -31,11 +34,25 @@ class AddrSpace {
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
 
+    void Checkpoint(int fd);		// Save the page table to the open
+					// host file "fd" (the contents are
+					// saved with the machine's memory)
+
   private:
-    TranslationEntry *pageTable;	// Assume linear page table translation
-					// for now!
+    void MapPages();			// Build a radix or inverted page table
+    void Account();			// Add our page table to the statistics
+
+    TranslationEntry *pageTable;	// Linear page table, if that is the
+					// format in use
+    PageTable *sparseTable;		// Otherwise, the radix or inverted
+					// page table
     unsigned int numPages;		// Number of pages in the virtual 
-					// address space
+					// address space (below the stack,
+					// with a sparse page table)
+    unsigned int stackPages;		// With a sparse page table, number of
+					// stack pages, at the top of the
+					// address space; otherwise 0
+    int asid;				// ID tagging our TLB entries
 };
 
 #endif // ADDRSPACE_H
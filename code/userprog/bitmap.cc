@@ -22,8 +22,8 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++) 
-        Clear(i);
+    for (int i = 0; i < numWords; i++) 
+        map[i] = 0;
 }
 
 //----------------------------------------------------------------------
@@ -89,16 +89,24 @@ BitMap::Test(int which)
 //	(In other words, find and allocate a bit.)
 //
 //	If no bits are clear, return -1.
+//
+//	Words with every bit set are skipped without testing each bit,
+//	so that large bitmaps (e.g. of physical memory) stay cheap.
 //----------------------------------------------------------------------
 
 int 
 BitMap::Find() 
 {
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
-	}
+    for (int w = 0; w < numWords; w++) {
+	if (map[w] == ~0u)		// all in use
+	    continue;
+	for (int i = w * BitsInWord; 
+		(i < (w + 1) * BitsInWord) && (i < numBits); i++)
+	    if (!Test(i)) {
+		Mark(i);
+		return i;
+	    }
+    }
     return -1;
 }
 
@@ -113,8 +121,18 @@ BitMap::NumClear()
 {
     int count = 0;
 
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
+    for (int w = 0; w < numWords; w++) {
+	int first = w * BitsInWord;
+	int last = min((w + 1) * BitsInWord, numBits);
+
+	if (map[w] == ~0u)		// all in use
+	    continue;
+	else if (map[w] == 0)		// all free
+	    count += last - first;
+	else
+	    for (int i = first; i < last; i++)
+		if (!Test(i)) count++;
+    }
     return count;
 }
 